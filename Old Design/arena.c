@@ -0,0 +1,116 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct ArenaChunk
+{
+    ArenaChunk *next;
+    size_t size; // usable bytes in data[]
+    size_t off;  // bump offset
+    _Alignas(16) unsigned char data[];
+};
+
+static size_t align16(size_t n)
+{
+    return (n + 15) & ~(size_t)15;
+}
+
+void arena_init(Arena *a, size_t chunk_size, size_t max_retained)
+{
+    memset(a, 0, sizeof(*a));
+    a->chunk_size = chunk_size ? chunk_size : ((size_t)1 << 20);
+    a->max_retained = max_retained;
+}
+
+static ArenaChunk *chunk_new(size_t size)
+{
+    ArenaChunk *c = malloc(sizeof(ArenaChunk) + size);
+    if (!c)
+        return NULL;
+    c->next = NULL;
+    c->size = size;
+    c->off = 0;
+    return c;
+}
+
+void *arena_alloc(Arena *a, size_t size)
+{
+    size = align16(size ? size : 1);
+    // try the current chunk, then any later (already reset) chunk that fits
+    for (ArenaChunk *c = a->current; c; c = c->next)
+    {
+        if (c->size - c->off >= size)
+        {
+            void *p = c->data + c->off;
+            c->off += size;
+            a->current = c;
+            a->used += size;
+            if (a->used > a->peak)
+                a->peak = a->used;
+            return p;
+        }
+    }
+    ArenaChunk *c = chunk_new(size > a->chunk_size ? size : a->chunk_size);
+    if (!c)
+        return NULL;
+    // keep the chunk list ordered so reset can walk it from the head
+    if (a->current)
+    {
+        c->next = a->current->next;
+        a->current->next = c;
+    }
+    else
+    {
+        c->next = a->chunks;
+        a->chunks = c;
+    }
+    a->current = c;
+    c->off = size;
+    a->used += size;
+    if (a->used > a->peak)
+        a->peak = a->used;
+    return c->data;
+}
+
+void *arena_calloc(Arena *a, size_t count, size_t size)
+{
+    void *p = arena_alloc(a, count * size);
+    if (p)
+        memset(p, 0, count * size);
+    return p;
+}
+
+void arena_reset(Arena *a)
+{
+    size_t kept = 0;
+    ArenaChunk **link = &a->chunks;
+    while (*link)
+    {
+        ArenaChunk *c = *link;
+        if (a->max_retained && kept + c->size > a->max_retained && kept > 0)
+        {
+            *link = c->next;
+            free(c);
+            continue;
+        }
+        kept += c->size;
+        c->off = 0;
+        link = &c->next;
+    }
+    a->current = a->chunks;
+    a->used = 0;
+}
+
+void arena_free(Arena *a)
+{
+    ArenaChunk *c = a->chunks;
+    while (c)
+    {
+        ArenaChunk *next = c->next;
+        free(c);
+        c = next;
+    }
+    a->chunks = NULL;
+    a->current = NULL;
+    a->used = 0;
+}
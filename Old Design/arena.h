@@ -0,0 +1,39 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator for per-hand solver memory.
+//
+// Allocations are carved out of large chunks and are never freed one by
+// one; arena_reset releases everything at once between hands while keeping
+// the chunks for the next hand, so a worker that solves thousands of hands
+// back to back does no malloc/free on the per-node path. Chunks beyond
+// max_retained bytes are returned to the system on reset, which caps how
+// much one unusually large hand can pin for the rest of the run.
+typedef struct ArenaChunk ArenaChunk;
+
+typedef struct Arena
+{
+    ArenaChunk *chunks;  // all chunks, most recent first
+    ArenaChunk *current; // chunk being bumped
+    size_t chunk_size;   // default chunk size
+    size_t max_retained; // bytes kept across arena_reset (0 = keep all)
+    size_t used;         // bytes handed out since the last reset
+    size_t peak;         // high-water mark of `used`
+} Arena;
+
+void arena_init(Arena *a, size_t chunk_size, size_t max_retained);
+
+// 16-byte aligned allocation; returns NULL only when out of memory
+void *arena_alloc(Arena *a, size_t size);
+
+// same, zero-filled
+void *arena_calloc(Arena *a, size_t count, size_t size);
+
+// release every allocation at once (chunks are kept up to max_retained)
+void arena_reset(Arena *a);
+
+void arena_free(Arena *a);
+
+#endif // ARENA_H
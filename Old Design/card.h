@@ -13,6 +13,33 @@ enum ManaColor
     COLOR_COUNT = 3
 };
 
+// spell classes a static cost modifier can apply to
+enum SpellClass
+{
+    SPELL_RED = 0,             // spells with red in their cost
+    SPELL_INSTANT_SORCERY = 1, // instant and sorcery spells
+    SPELL_CLASS_COUNT = 2
+};
+
+// static cost effect of a permanent while it is on the battlefield: spells
+// of class `spell_class` cost `generic` less generic mana (0 = no effect)
+typedef struct CostModifier
+{
+    int spell_class;
+    int generic;
+} CostModifier;
+
+// what a card does for the combo, used to order moves during search
+enum CardRole
+{
+    ROLE_OTHER = 0,
+    ROLE_RITUAL = 1, // nets mana
+    ROLE_ENGINE = 2, // permanent that makes later spells cheaper
+    ROLE_CANTRIP = 3, // digs for more cards
+    ROLE_PAYOFF = 4, // storm finisher: deals at most storm count + 1 damage
+    ROLE_COUNT = 5
+};
+
 typedef struct Card
 {
     const char *name;
@@ -33,6 +60,12 @@ typedef struct Card
     int land_color;
     // ability: applies effect when the card is played. Can be NULL for lands.
     void (*ability)(GameState *state, int hand_index);
+    // static cost reduction granted while this card is on the battlefield
+    CostModifier cost_mod;
+    // move-ordering role (CardRole)
+    int role;
+    // most mana the ability adds (rituals), for the search's damage bound
+    int mana_produced;
 } Card;
 
 #endif // CARD_H
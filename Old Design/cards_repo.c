@@ -14,7 +14,7 @@ static void grapeshot_ability(GameState *s, int hand_index)
 static void ritual_ability(GameState *s, int hand_index)
 {
     (void)hand_index;
-    s->player_mana[RED] += 3;
+    add_mana(s, RED, 3);
 }
 
 static void impulse_ability(GameState *s, int hand_index)
@@ -23,7 +23,7 @@ static void impulse_ability(GameState *s, int hand_index)
     // Request two draws. The solver will resolve pending_draws as branching
     // events so we can compute exact probabilities rather than performing a
     // random draw here.
-    s->pending_draws += 2;
+    request_draws(s, 2);
 }
 
 // Build a small sample card pool: index 0 = Mountain (red land), 1 = Island (blue land),
@@ -74,6 +74,7 @@ void init_sample_cards()
     sample_pool[3].cost_color[GREEN] = 0;
     sample_pool[3].land_color = -1;
     sample_pool[3].ability = grapeshot_ability;
+    sample_pool[3].role = ROLE_PAYOFF;
 
     // Ruby Medallion (artifact) : reduces cost of red spells by 1 (passive)
     sample_pool[4].name = "Ruby Medallion";
@@ -84,6 +85,8 @@ void init_sample_cards()
     sample_pool[4].cost_color[GREEN] = 0;
     sample_pool[4].land_color = -1;
     sample_pool[4].ability = NULL;
+    sample_pool[4].role = ROLE_ENGINE;
+    sample_pool[4].cost_mod = (CostModifier){SPELL_RED, 1};
 
     // Pyretic Ritual (red spell) : 2R -> add RRR
     sample_pool[5].name = "Pyretic Ritual";
@@ -94,6 +97,8 @@ void init_sample_cards()
     sample_pool[5].cost_color[GREEN] = 0;
     sample_pool[5].land_color = -1;
     sample_pool[5].ability = ritual_ability;
+    sample_pool[5].role = ROLE_RITUAL;
+    sample_pool[5].mana_produced = 3;
 
     // Impulse
     sample_pool[6].name = "Impulse";
@@ -104,6 +109,7 @@ void init_sample_cards()
     sample_pool[6].cost_color[GREEN] = 0;
     sample_pool[6].land_color = -1;
     sample_pool[6].ability = impulse_ability;
+    sample_pool[6].role = ROLE_CANTRIP;
 }
 
 const Card *get_sample_card_pool(int *out_size)
@@ -0,0 +1,117 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "checkpoint.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+static int alloc_arrays(Checkpoint *ck)
+{
+    size_t nhands = ck->hdr.nhands;
+    ck->done = calloc(nhands + 1, 1);
+    ck->prob = calloc(nhands + 1, sizeof(double));
+    ck->turn_prob = ck->hdr.nprob ? calloc(nhands * ck->hdr.nprob, sizeof(float)) : NULL;
+    if (!ck->done || !ck->prob || (ck->hdr.nprob && !ck->turn_prob))
+    {
+        checkpoint_free(ck);
+        return -1;
+    }
+    return 0;
+}
+
+int checkpoint_alloc(Checkpoint *ck, int max_turns, int nhands, int nprob, const int *deck, int deck_size)
+{
+    memset(ck, 0, sizeof(*ck));
+    memcpy(ck->hdr.magic, CHECKPOINT_MAGIC, 4);
+    ck->hdr.version = CHECKPOINT_VERSION;
+    ck->hdr.max_turns = (uint32_t)max_turns;
+    ck->hdr.nhands = (uint32_t)nhands;
+    ck->hdr.nprob = (uint32_t)nprob;
+    for (int i = 0; i < deck_size; ++i)
+        ck->hdr.deck_counts[deck[i]]++;
+    return alloc_arrays(ck);
+}
+
+int checkpoint_write(const Checkpoint *ck, const char *path)
+{
+    size_t nhands = ck->hdr.nhands;
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+    if (!f)
+    {
+        fprintf(stderr, "cannot write checkpoint %s\n", tmp);
+        return -1;
+    }
+    int ok = fwrite(&ck->hdr, sizeof(ck->hdr), 1, f) == 1 && fwrite(ck->done, 1, nhands, f) == nhands &&
+             fwrite(ck->prob, sizeof(double), nhands, f) == nhands &&
+             (!ck->hdr.nprob || fwrite(ck->turn_prob, sizeof(float) * ck->hdr.nprob, nhands, f) == nhands);
+    // the data must be on disk before the rename makes it the checkpoint
+    ok = ok && fflush(f) == 0;
+#ifndef _WIN32
+    ok = ok && fsync(fileno(f)) == 0;
+#endif
+    if (fclose(f) != 0 || !ok)
+    {
+        fprintf(stderr, "error writing checkpoint %s\n", tmp);
+        remove(tmp);
+        return -1;
+    }
+#ifdef _WIN32
+    // rename does not replace an existing file here
+    remove(path);
+#endif
+    if (rename(tmp, path) != 0)
+    {
+        fprintf(stderr, "cannot replace checkpoint %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+int checkpoint_read(Checkpoint *ck, const char *path)
+{
+    memset(ck, 0, sizeof(*ck));
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        if (errno == ENOENT)
+            return 1;
+        fprintf(stderr, "cannot open checkpoint %s\n", path);
+        return -1;
+    }
+    if (fread(&ck->hdr, sizeof(ck->hdr), 1, f) != 1 || memcmp(ck->hdr.magic, CHECKPOINT_MAGIC, 4) != 0 ||
+        ck->hdr.version != CHECKPOINT_VERSION || (ck->hdr.nprob && ck->hdr.nprob != ck->hdr.max_turns))
+    {
+        fprintf(stderr, "%s is not a checkpoint\n", path);
+        fclose(f);
+        return -1;
+    }
+    size_t nhands = ck->hdr.nhands;
+    if (alloc_arrays(ck) != 0 || fread(ck->done, 1, nhands, f) != nhands ||
+        fread(ck->prob, sizeof(double), nhands, f) != nhands ||
+        (ck->hdr.nprob && fread(ck->turn_prob, sizeof(float) * ck->hdr.nprob, nhands, f) != nhands))
+    {
+        fprintf(stderr, "cannot read checkpoint %s\n", path);
+        checkpoint_free(ck);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return 0;
+}
+
+void checkpoint_free(Checkpoint *ck)
+{
+    free(ck->done);
+    free(ck->prob);
+    free(ck->turn_prob);
+    ck->done = NULL;
+    ck->prob = NULL;
+    ck->turn_prob = NULL;
+}
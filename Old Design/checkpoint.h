@@ -0,0 +1,54 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include "game.h"
+
+// Checkpoint of an exhaustive run, so a killed or preempted run can resume.
+//
+// Hands finish out of order on the pool, so the enumeration position is
+// kept as a done flag per hand (in HandIter order) rather than a single
+// index, alongside each finished hand's P(win), its per-turn row when the
+// run builds a keep table, and the aggregate counters over the finished
+// hands. The file is written to "<path>.tmp" and renamed over path, so a
+// crash mid-write leaves the previous checkpoint intact.
+
+#define CHECKPOINT_MAGIC "SDCK"
+#define CHECKPOINT_VERSION 1
+
+typedef struct CheckpointHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t max_turns;
+    uint32_t nhands;
+    uint32_t nprob;  // floats per hand in turn_prob: max_turns, or 0 without a keep table
+    uint32_t solved; // finished hands
+    uint32_t wins;   // finished hands with P(win) > 0
+    uint32_t pad;
+    uint8_t deck_counts[MAX_CARD_IDS];
+} CheckpointHeader;
+
+// header, then uint8 done[nhands], double prob[nhands],
+// float turn_prob[nhands][nprob]
+typedef struct Checkpoint
+{
+    CheckpointHeader hdr;
+    unsigned char *done;
+    double *prob;
+    float *turn_prob; // NULL when nprob is 0
+} Checkpoint;
+
+// Set up an empty checkpoint for nhands hands. Returns 0 on success.
+int checkpoint_alloc(Checkpoint *ck, int max_turns, int nhands, int nprob, const int *deck, int deck_size);
+
+// Write ck to path atomically. Returns 0 on success.
+int checkpoint_write(const Checkpoint *ck, const char *path);
+
+// Read a checkpoint written by checkpoint_write. Returns 0 on success, 1 if
+// path does not exist, -1 on any other error.
+int checkpoint_read(Checkpoint *ck, const char *path);
+
+void checkpoint_free(Checkpoint *ck);
+
+#endif // CHECKPOINT_H
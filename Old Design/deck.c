@@ -1,5 +1,7 @@
 #include "deck.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 void shuffle_deck(int *deck, int n)
@@ -27,3 +29,50 @@ int draw_hand_from_deck(int *deck, int deck_n, int *hand_out, int n)
         hand_out[i] = deck[i];
     return take;
 }
+
+int load_deck(const char *path, const Card *pool, int pool_size, int *deck_out, int max_cards)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+        fprintf(stderr, "cannot open deck %s\n", path);
+        return -1;
+    }
+    int n = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f))
+    {
+        char *p = line;
+        while (*p == ' ' || *p == '\t')
+            ++p;
+        if (*p == '\0' || *p == '\n' || *p == '\r' || *p == '#')
+            continue;
+        char *name;
+        long count = strtol(p, &name, 10);
+        if (name == p || count < 0)
+        {
+            fprintf(stderr, "%s: bad line: %s", path, line);
+            fclose(f);
+            return -1;
+        }
+        while (*name == ' ' || *name == '\t')
+            ++name;
+        name[strcspn(name, "\r\n")] = '\0';
+        int id = -1;
+        for (int i = 0; i < pool_size; ++i)
+        {
+            if (pool[i].name && strcmp(pool[i].name, name) == 0)
+                id = i;
+        }
+        if (id < 0)
+        {
+            fprintf(stderr, "%s: unknown card \"%s\"\n", path, name);
+            fclose(f);
+            return -1;
+        }
+        for (long k = 0; k < count && n < max_cards; ++k)
+            deck_out[n++] = id;
+    }
+    fclose(f);
+    return n;
+}
@@ -10,4 +10,10 @@ void shuffle_deck(int *deck, int n);
 // returns number drawn
 int draw_hand_from_deck(int *deck, int deck_n, int *hand_out, int n);
 
+// Load a decklist of "<count> <card name>" lines, naming cards of pool.
+// Blank lines and lines starting with '#' are skipped. Returns the number of
+// cards written to deck_out (at most max_cards), or -1 if the file cannot be
+// read or names a card that is not in the pool.
+int load_deck(const char *path, const Card *pool, int pool_size, int *deck_out, int max_cards);
+
 #endif // DECK_H
@@ -1,7 +1,12 @@
 #include "game.h"
+#include "ttable.h"
+#include "hands.h"
+#include "movegen.h"
 #include <stdatomic.h>
+#include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 
 static const char *color_name(int c)
 {
@@ -59,31 +64,136 @@ void print_state(const GameState *s)
 
 void clone_state(const GameState *src, GameState *dst)
 {
-    // Deep-copy GameState: copy structure and duplicate library if present.
-    // We avoid a raw memcpy because GameState now contains a dynamic library pointer.
+    // The library lives inside GameState, so a struct copy is a full clone.
     *dst = *src;
     // clear transient draw log in the destination; draws should be recorded only
-    // for actions that happen after cloning (so bfs_solve can report them).
+    // for actions that happen after cloning (so a printed line can report them).
     dst->last_drawn_count = 0;
     for (int _i = 0; _i < 8; ++_i)
         dst->last_drawn_ids[_i] = -1;
     dst->last_oplife_count = 0;
     for (int _i = 0; _i < 8; ++_i)
         dst->last_oplife_deltas[_i] = 0;
+}
+
+// ---------------------------------------------------------------------------
+// State keys
+//
+// Each scalar field contributes key_term(field, index, value) and each card
+// in a zone contributes key_term(zone, card_id, 0). Terms are combined by
+// wrapping addition, so a mutator only adds the new term and subtracts the
+// old one, and repeated cards in a zone are counted with multiplicity.
+
+enum KeyField
+{
+    KEY_TURN,
+    KEY_MANA,
+    KEY_PERM_MANA,
+    KEY_OPP_LIFE,
+    KEY_LANDS,
+    KEY_LANDS_TAPPED,
+    KEY_LAND_PLAYED,
+    KEY_STORM,
+    KEY_PENDING,
+    KEY_HAND,
+    KEY_LIBRARY,
+    KEY_LIBRARY_TOP,
+    KEY_GRAVEYARD,
+    KEY_PERMANENT
+};
+
+static inline uint64_t key_term(int field, int index, int value)
+{
+    // splitmix64 finalizer over the packed (field, index, value) triple
+    uint64_t x = ((uint64_t)field << 48) ^ ((uint64_t)(uint16_t)index << 32) ^ (uint32_t)value;
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// set *slot to value and update the key for (field, index)
+static inline void key_set(GameState *s, int field, int index, int *slot, int value)
+{
+    s->key += key_term(field, index, value) - key_term(field, index, *slot);
+    *slot = value;
+}
+
+static inline void key_add_card(GameState *s, int zone, int card_id)
+{
+    s->key += key_term(zone, card_id, 0);
+}
+
+static inline void key_remove_card(GameState *s, int zone, int card_id)
+{
+    s->key -= key_term(zone, card_id, 0);
+}
 
-    if (src->library && src->library_size > 0)
+uint64_t state_key(const GameState *s)
+{
+    uint64_t k = 0;
+    k += key_term(KEY_TURN, 0, s->turn);
+    k += key_term(KEY_OPP_LIFE, 0, s->opponent_life);
+    k += key_term(KEY_LAND_PLAYED, 0, s->land_played_this_turn);
+    k += key_term(KEY_STORM, 0, s->storm_count);
+    k += key_term(KEY_PENDING, 0, s->pending_draws);
+    for (int i = 0; i < COLOR_COUNT; ++i)
     {
-        dst->library = malloc(sizeof(int) * src->library_size);
-        if (dst->library)
-            memcpy(dst->library, src->library, sizeof(int) * src->library_size);
-        else
-            dst->library_size = 0;
+        k += key_term(KEY_MANA, i, s->player_mana[i]);
+        k += key_term(KEY_PERM_MANA, i, s->permanent_mana[i]);
+        k += key_term(KEY_LANDS, i, s->battlefield_lands[i]);
+        k += key_term(KEY_LANDS_TAPPED, i, s->battlefield_lands_tapped[i]);
     }
-    else
+    for (int i = 0; i < s->hand_count; ++i)
+        if (!s->hand_used[i])
+            k += key_term(KEY_HAND, s->hand_ids[i], 0);
+    for (int i = 0; i < MAX_CARD_IDS; ++i)
+        k += (uint64_t)s->library_counts[i] * key_term(KEY_LIBRARY, i, 0);
+    for (int i = 0; i < s->library_top_count; ++i)
+        k += key_term(KEY_LIBRARY_TOP, i, s->library_top[i]);
+    for (int i = 0; i < s->graveyard_count; ++i)
+        k += key_term(KEY_GRAVEYARD, s->graveyard[i].card_id, 0);
+    for (int i = 0; i < s->battlefield_permanent_count; ++i)
+        k += key_term(KEY_PERMANENT, s->battlefield_permanents[i], 0);
+    return k;
+}
+
+void state_rekey(GameState *s)
+{
+    s->key = state_key(s);
+}
+
+void add_mana(GameState *s, int color, int amount)
+{
+    if (color < 0 || color >= COLOR_COUNT)
+        return;
+    key_set(s, KEY_MANA, color, &s->player_mana[color], s->player_mana[color] + amount);
+}
+
+void request_draws(GameState *s, int n)
+{
+    key_set(s, KEY_PENDING, 0, &s->pending_draws, s->pending_draws + n);
+}
+
+int take_pending_draws(GameState *s)
+{
+    int n = s->pending_draws;
+    key_set(s, KEY_PENDING, 0, &s->pending_draws, 0);
+    return n;
+}
+
+void begin_next_turn(GameState *s)
+{
+    key_set(s, KEY_TURN, 0, &s->turn, s->turn + 1);
+    for (int i = 0; i < COLOR_COUNT; ++i)
     {
-        dst->library = NULL;
-        dst->library_size = 0;
+        // untap lands; player mana starts empty and lands must be tapped
+        key_set(s, KEY_LANDS_TAPPED, i, &s->battlefield_lands_tapped[i], 0);
+        key_set(s, KEY_MANA, i, &s->player_mana[i], 0);
     }
+    key_set(s, KEY_LAND_PLAYED, 0, &s->land_played_this_turn, 0);
+    // reset storm count at the beginning of a new turn
+    key_set(s, KEY_STORM, 0, &s->storm_count, 0);
 }
 
 // helper to add an entry to the graveyard
@@ -96,6 +206,19 @@ static void add_to_graveyard(GameState *s, int card_id, int reason)
     s->graveyard[s->graveyard_count].turn_entered = s->turn;
     s->graveyard[s->graveyard_count].storm_at_entry = s->storm_count;
     s->graveyard_count++;
+    key_add_card(s, KEY_GRAVEYARD, card_id);
+}
+
+// Generic cost of c after the static reductions of the permanents in play:
+// one term per spell class the card belongs to.
+static inline int reduced_generic(const GameState *s, const Card *c)
+{
+    int generic = c->cost_generic;
+    if (c->cost_color[RED] > 0)
+        generic -= s->cost_reduction[SPELL_RED];
+    if (c->type == CARD_INSTANT || c->type == CARD_SORCERY)
+        generic -= s->cost_reduction[SPELL_INSTANT_SORCERY];
+    return generic < 0 ? 0 : generic;
 }
 
 // Check if state has enough mana to pay a card's cost
@@ -105,51 +228,142 @@ static int can_pay_cost(const GameState *s, const Card *c)
     fprintf(stderr, "can_pay_cost: checking %s (cost %d + R%d B%d G%d)\n", c->name, c->cost_generic, c->cost_color[RED], c->cost_color[BLUE], c->cost_color[GREEN]);
     fprintf(stderr, "  player_mana R%d B%d G%d\n", s->player_mana[RED], s->player_mana[BLUE], s->player_mana[GREEN]);
 #endif
-    // colored requirements
+    // colored requirements, then generic from whatever is left
+    int free = 0;
     for (int i = 0; i < COLOR_COUNT; ++i)
     {
         if (s->player_mana[i] < c->cost_color[i])
             return 0;
+        free += s->player_mana[i] - c->cost_color[i];
     }
-    // generic requirement: sum of remaining mana across colors
-    int generic = c->cost_generic;
-    // apply permanent-based reductions (e.g., Ruby Medallion reduces generic cost of red spells)
-    int reduction = 0;
-    for (int p = 0; p < s->battlefield_permanent_count; ++p)
+    return free >= reduced_generic(s, c);
+}
+
+uint32_t playable_mask(const GameState *s)
+{
+    // the pool total is shared by every card, so each slot is just the
+    // colored checks plus one comparison
+    int pool = 0;
+    for (int i = 0; i < COLOR_COUNT; ++i)
+        pool += s->player_mana[i];
+    uint32_t mask = 0;
+    for (int h = 0; h < s->hand_count; ++h)
     {
-        int pid = s->battlefield_permanents[p];
-        if (pid < 0 || pid >= s->card_pool_size)
+        if (s->hand_used[h])
             continue;
-        const Card *perm = &s->card_pool[pid];
-        if (perm->type == CARD_ARTIFACT && perm->name && strcmp(perm->name, "Ruby Medallion") == 0)
+        const Card *c = &s->card_pool[s->hand_ids[h]];
+        if (c->type == CARD_LAND)
         {
-            // reduces generic cost of red spells by 1
-            if (c->cost_color[RED] > 0)
-                reduction += 1;
+            if (!s->land_played_this_turn && c->land_color >= 0 && c->land_color < COLOR_COUNT)
+                mask |= 1u << h;
+            continue;
         }
-        if (perm->type == CARD_CREATURE && perm->name && strcmp(perm->name, "Ral, Monsoon Mage") == 0)
+        if (s->player_mana[RED] < c->cost_color[RED] || s->player_mana[BLUE] < c->cost_color[BLUE] ||
+            s->player_mana[GREEN] < c->cost_color[GREEN])
+            continue;
+        int colored = c->cost_color[RED] + c->cost_color[BLUE] + c->cost_color[GREEN];
+        if (pool - colored >= reduced_generic(s, c))
+            mask |= 1u << h;
+    }
+    return mask;
+}
+
+// Upper bound on the damage the player can still deal this turn. Relaxes
+// the turn to: every card in hand (and, if a cantrip could dig, every card
+// left in the library) is available; colors and cast order are ignored;
+// every cost-reducing permanent that could be cast is already in play; and
+// mana is only a budget. Spells that cost no more than the mana they make
+// are all cast for free, the rest cheapest first, and the payoffs are cast
+// last, each dealing storm + 1. Each relaxation can only add damage, so the
+// bound never underestimates.
+int damage_upper_bound(const GameState *s)
+{
+    int avail[MAX_CARD_IDS] = {0};
+    int cantrip = 0;
+    for (int h = 0; h < s->hand_count; ++h)
+    {
+        if (s->hand_used[h])
+            continue;
+        int cid = s->hand_ids[h];
+        avail[cid]++;
+        cantrip |= s->card_pool[cid].role == ROLE_CANTRIP;
+    }
+    if (cantrip)
+    {
+        for (int cid = 0; cid < MAX_CARD_IDS; ++cid)
+            avail[cid] += s->library_counts[cid];
+        for (int t = 0; t < s->library_top_count; ++t)
+            avail[s->library_top[t]]++;
+    }
+
+    int mana = 0;
+    for (int i = 0; i < COLOR_COUNT; ++i)
+        mana += s->player_mana[i] + s->battlefield_lands[i] - s->battlefield_lands_tapped[i];
+    int reduction[SPELL_CLASS_COUNT];
+    for (int k = 0; k < SPELL_CLASS_COUNT; ++k)
+        reduction[k] = s->cost_reduction[k];
+    int land = 0;
+    for (int cid = 0; cid < s->card_pool_size && cid < MAX_CARD_IDS; ++cid)
+    {
+        if (!avail[cid])
+            continue;
+        const Card *c = &s->card_pool[cid];
+        land |= c->type == CARD_LAND;
+        const CostModifier *m = &c->cost_mod;
+        if (m->generic > 0 && m->spell_class >= 0 && m->spell_class < SPELL_CLASS_COUNT)
+            reduction[m->spell_class] += avail[cid] * m->generic;
+    }
+    if (land && !s->land_played_this_turn)
+        mana += 1;
+
+    // net cost (cost - mana made) of each available spell
+    int spells = 0, payoffs = 0;
+    int net[MAX_CARD_IDS], copies[MAX_CARD_IDS], n = 0;
+    for (int cid = 0; cid < s->card_pool_size && cid < MAX_CARD_IDS; ++cid)
+    {
+        const Card *c = &s->card_pool[cid];
+        if (!avail[cid] || c->type == CARD_LAND)
+            continue;
+        int generic = c->cost_generic;
+        if (c->cost_color[RED] > 0)
+            generic -= reduction[SPELL_RED];
+        if (c->type == CARD_INSTANT || c->type == CARD_SORCERY)
+            generic -= reduction[SPELL_INSTANT_SORCERY];
+        int cost = c->cost_color[RED] + c->cost_color[BLUE] + c->cost_color[GREEN] + (generic > 0 ? generic : 0);
+        if (c->role == ROLE_PAYOFF)
+            payoffs += avail[cid];
+        if (cost <= c->mana_produced)
         {
-            // reduces generic cost of blue spells by 1
-            if (c->type == CARD_INSTANT || c->type == CARD_SORCERY)
-                reduction += 1;
+            spells += avail[cid];
+            mana += avail[cid] * (c->mana_produced - cost);
+            continue;
         }
-        if (perm->type == CARD_CREATURE && perm->name && strcmp(perm->name, "Stormcatch Mentor") == 0)
+        // insertion by net cost, cheapest first
+        int j = n++;
+        while (j > 0 && net[j - 1] > cost - c->mana_produced)
         {
-            // reduces generic cost of blue spells by 1
-            if (c->type == CARD_INSTANT || c->type == CARD_SORCERY)
-                reduction += 1;
+            net[j] = net[j - 1];
+            copies[j] = copies[j - 1];
+            --j;
         }
+        net[j] = cost - c->mana_produced;
+        copies[j] = avail[cid];
     }
-    if (reduction > 0)
+    for (int i = 0; i < n && mana >= net[i]; ++i)
     {
-        generic -= reduction;
-        if (generic < 0)
-            generic = 0;
+        int k = mana / net[i];
+        if (k > copies[i])
+            k = copies[i];
+        spells += k;
+        mana -= k * net[i];
     }
-    int free = 0;
-    for (int i = 0; i < COLOR_COUNT; ++i)
-        free += s->player_mana[i] - c->cost_color[i];
-    return free >= generic;
+
+    // payoffs cast as spells spells-g+1 .. spells of the turn
+    int g = payoffs < spells ? payoffs : spells;
+    int damage = 0;
+    for (int k = spells - g + 1; k <= spells; ++k)
+        damage += s->storm_count + k;
+    return damage;
 }
 
 // Pay the cost (transactional). Returns 0 on success, -1 on failure.
@@ -167,27 +381,7 @@ static int pay_cost(GameState *s, const Card *c)
             return -1; // shouldn't happen if can_pay_cost was used
     }
     // pay generic from any colored mana (greedy by color)
-    int gen = c->cost_generic;
-    // apply permanent-based reductions (same as can_pay_cost)
-    int reduction = 0;
-    for (int p = 0; p < s->battlefield_permanent_count; ++p)
-    {
-        int pid = s->battlefield_permanents[p];
-        if (pid < 0 || pid >= s->card_pool_size)
-            continue;
-        const Card *perm = &s->card_pool[pid];
-        if (perm->type == CARD_ARTIFACT && perm->name && strcmp(perm->name, "Ruby Medallion") == 0)
-        {
-            if (c->cost_color[RED] > 0)
-                reduction += 1;
-        }
-    }
-    if (reduction > 0)
-    {
-        gen -= reduction;
-        if (gen < 0)
-            gen = 0;
-    }
+    int gen = reduced_generic(s, c);
     for (int i = 0; i < COLOR_COUNT && gen > 0; ++i)
     {
         int take = tmp[i] < gen ? tmp[i] : gen;
@@ -199,32 +393,102 @@ static int pay_cost(GameState *s, const Card *c)
 
     // commit
     for (int i = 0; i < COLOR_COUNT; ++i)
-        s->player_mana[i] = tmp[i];
+        key_set(s, KEY_MANA, i, &s->player_mana[i], tmp[i]);
 #ifdef DEBUG_TRACE
     fprintf(stderr, "pay_cost: paid %s, remaining mana R%d B%d G%d\n", c->name, s->player_mana[RED], s->player_mana[BLUE], s->player_mana[GREEN]);
 #endif
     return 0;
 }
 
-// Draw a random card from the library into the player's hand. If the hand has
-// no empty slots (i.e. no slot marked hand_used==1), the drawn card is moved to
-// the graveyard. Returns 0 on success, -1 if the library is empty or other
-// failure.
-int draw_card(GameState *s, int idx)
+// fold a permanent's static cost modifier into (sign 1) or out of (sign -1)
+// the state's per-class reductions
+static void apply_cost_mod(GameState *s, const Card *c, int sign)
+{
+    const CostModifier *m = &c->cost_mod;
+    if (m->generic != 0 && m->spell_class >= 0 && m->spell_class < SPELL_CLASS_COUNT)
+        s->cost_reduction[m->spell_class] += sign * m->generic;
+}
+
+int add_permanent(GameState *s, int cid)
+{
+    if (cid < 0 || cid >= s->card_pool_size || s->battlefield_permanent_count >= MAX_PERMANENTS)
+        return -1;
+    s->battlefield_permanents[s->battlefield_permanent_count++] = cid;
+    key_add_card(s, KEY_PERMANENT, cid);
+    apply_cost_mod(s, &s->card_pool[cid], 1);
+    return 0;
+}
+
+int remove_permanent(GameState *s, int index)
+{
+    if (index < 0 || index >= s->battlefield_permanent_count)
+        return -1;
+    int cid = s->battlefield_permanents[index];
+    s->battlefield_permanents[index] = s->battlefield_permanents[--s->battlefield_permanent_count];
+    key_remove_card(s, KEY_PERMANENT, cid);
+    apply_cost_mod(s, &s->card_pool[cid], -1);
+    return cid;
+}
+
+void library_add(GameState *s, int cid)
+{
+    if (cid < 0 || cid >= MAX_CARD_IDS || s->library_counts[cid] == UINT8_MAX)
+        return;
+    s->library_counts[cid]++;
+    s->library_size++;
+    key_add_card(s, KEY_LIBRARY, cid);
+}
+
+int library_put_top(GameState *s, int cid)
+{
+    if (cid < 0 || cid >= MAX_CARD_IDS || s->library_counts[cid] == 0 || s->library_top_count >= LIBRARY_TOP_MAX)
+        return -1;
+    s->library_counts[cid]--;
+    key_remove_card(s, KEY_LIBRARY, cid);
+    int pos = s->library_top_count++;
+    s->library_top[pos] = cid;
+    s->key += key_term(KEY_LIBRARY_TOP, pos, cid);
+    return 0;
+}
+
+// Draw a card from the library into the player's hand: the known top card if
+// there is one, else the requested (or a random) card from the unknown part.
+// If the hand has no empty slots (i.e. no slot marked hand_used==1), the drawn
+// card is moved to the graveyard. Returns the card id, or -1 if the library
+// is empty or holds no copy of cid.
+int draw_card(GameState *s, int cid)
 {
-    if (!s || !s->library || s->library_size <= 0)
+    if (!s || s->library_size <= 0)
         return -1;
-    if (idx == -1)
+    if (s->library_top_count > 0)
     {
-        // legacy random draw
-        idx = rand() % s->library_size;
+        // known top cards are drawn in order; shift the rest of the prefix up
+        for (int i = 0; i < s->library_top_count; ++i)
+            s->key -= key_term(KEY_LIBRARY_TOP, i, s->library_top[i]);
+        cid = s->library_top[0];
+        s->library_top_count--;
+        memmove(&s->library_top[0], &s->library_top[1], sizeof(int) * s->library_top_count);
+        for (int i = 0; i < s->library_top_count; ++i)
+            s->key += key_term(KEY_LIBRARY_TOP, i, s->library_top[i]);
+    }
+    else
+    {
+        if (cid == -1)
+        {
+            // legacy random draw, weighted by remaining copies
+            int r = rand() % s->library_size;
+            for (cid = 0; cid < MAX_CARD_IDS; ++cid)
+            {
+                if (r < s->library_counts[cid])
+                    break;
+                r -= s->library_counts[cid];
+            }
+        }
+        if (cid < 0 || cid >= MAX_CARD_IDS || s->library_counts[cid] == 0)
+            return -1;
+        s->library_counts[cid]--;
+        key_remove_card(s, KEY_LIBRARY, cid);
     }
-    if (idx < 0 || idx >= s->library_size)
-        return -1;
-    int cid = s->library[idx];
-    // remove from library by shifting
-    for (int i = idx; i + 1 < s->library_size; ++i)
-        s->library[i] = s->library[i + 1];
     s->library_size -= 1;
 
     // find first empty hand slot (hand_used == 1) to place the drawn card
@@ -234,6 +498,7 @@ int draw_card(GameState *s, int idx)
         {
             s->hand_ids[h] = cid;
             s->hand_used[h] = 0;
+            key_add_card(s, KEY_HAND, cid);
             // record transient draw
             if (s->last_drawn_count < 8)
                 s->last_drawn_ids[s->last_drawn_count++] = cid;
@@ -251,7 +516,7 @@ void change_opponent_life(GameState *s, int delta)
 {
     if (!s)
         return;
-    s->opponent_life += delta;
+    key_set(s, KEY_OPP_LIFE, 0, &s->opponent_life, s->opponent_life + delta);
     if (s->last_oplife_count < 8)
         s->last_oplife_deltas[s->last_oplife_count++] = delta;
 }
@@ -266,6 +531,9 @@ int play_card(GameState *s, int hand_index)
     if (cid < 0 || cid >= s->card_pool_size)
         return -1;
     const Card *c = &s->card_pool[cid];
+    // enforce one land per turn before touching the state
+    if (c->type == CARD_LAND && (s->land_played_this_turn || c->land_color < 0 || c->land_color >= COLOR_COUNT))
+        return -1;
     if (!can_pay_cost(s, c))
         return -1;
     // pay cost (transactional)
@@ -275,18 +543,14 @@ int play_card(GameState *s, int hand_index)
     fprintf(stderr, "play_card: played %s on turn %d, storm=%d\n", c->name, s->turn, s->storm_count);
 #endif
     s->hand_used[hand_index] = 1;
+    key_remove_card(s, KEY_HAND, cid);
     // if land, increase permanent mana/battlefield count
     if (c->type == CARD_LAND)
     {
-        // enforce one land per turn
-        if (s->land_played_this_turn)
-            return -1;
         int lc = c->land_color;
-        if (lc < 0 || lc >= COLOR_COUNT)
-            return -1;
-        s->permanent_mana[lc] += 1;
-        s->battlefield_lands[lc] += 1;
-        s->land_played_this_turn = 1;
+        key_set(s, KEY_PERM_MANA, lc, &s->permanent_mana[lc], s->permanent_mana[lc] + 1);
+        key_set(s, KEY_LANDS, lc, &s->battlefield_lands[lc], s->battlefield_lands[lc] + 1);
+        key_set(s, KEY_LAND_PLAYED, 0, &s->land_played_this_turn, 1);
         // lands enter untapped by default in this simplified model
     }
     if (c->ability)
@@ -294,12 +558,11 @@ int play_card(GameState *s, int hand_index)
     // increase storm for non-land spells (lands do NOT count as spells)
     if (c->type != CARD_LAND)
     {
-        s->storm_count += 1;
+        key_set(s, KEY_STORM, 0, &s->storm_count, s->storm_count + 1);
         // if this is a permanent (artifact/creature/enchantment), place on battlefield
         if (c->type == CARD_ARTIFACT || c->type == CARD_CREATURE)
         {
-            if (s->battlefield_permanent_count < MAX_PERMANENTS)
-                s->battlefield_permanents[s->battlefield_permanent_count++] = cid;
+            add_permanent(s, cid);
         }
         else
         {
@@ -317,8 +580,8 @@ int tap_land_color(GameState *s, int color)
     int untapped = s->battlefield_lands[color] - s->battlefield_lands_tapped[color];
     if (untapped <= 0)
         return -1;
-    s->battlefield_lands_tapped[color] += 1;
-    s->player_mana[color] += 1;
+    key_set(s, KEY_LANDS_TAPPED, color, &s->battlefield_lands_tapped[color], s->battlefield_lands_tapped[color] + 1);
+    add_mana(s, color, 1);
     return 0;
 }
 
@@ -327,580 +590,427 @@ int check_win(const GameState *s)
     return s->opponent_life <= 0;
 }
 
-// serialize state to string
-static void serialize_state(const GameState *s, char *out, int out_size)
-{
-    char handmask[32] = {0};
-    int pos = 0;
-    for (int i = 0; i < s->hand_count && pos < (int)sizeof(handmask) - 2; ++i)
-    {
-        handmask[pos++] = s->hand_used[i] ? '1' : '0';
-    }
-    handmask[pos] = 0;
-    // include per-color mana/lands and storm/graveyard in serialization
-    int off = snprintf(out, out_size,
-                       "T%d|MR%d,MB%d,MG%d|PR%d,PB%d,PG%d|O%d|H%s|Lr%d,g%d,b%d|Tt%d,%d,%d|LP%d|Storm%d|GY%d",
-                       s->turn,
-                       s->player_mana[RED], s->player_mana[BLUE], s->player_mana[GREEN],
-                       s->permanent_mana[RED], s->permanent_mana[BLUE], s->permanent_mana[GREEN],
-                       s->opponent_life, handmask,
-                       s->battlefield_lands[RED], s->battlefield_lands[GREEN], s->battlefield_lands[BLUE],
-                       s->battlefield_lands_tapped[RED], s->battlefield_lands_tapped[BLUE], s->battlefield_lands_tapped[GREEN],
-                       s->land_played_this_turn,
-                       s->storm_count,
-                       s->graveyard_count);
-    if (off < 0)
-        off = 0;
-    if (off >= out_size)
-        off = out_size - 1;
-    // append graveyard entries (ordered) to the serialization as id:reason:turn
-    for (int i = 0; i < s->graveyard_count && off < out_size - 1; ++i)
-    {
-        int rem = out_size - off;
-        int added = snprintf(out + off, rem, ",%d:%d:%d", s->graveyard[i].card_id, s->graveyard[i].reason, s->graveyard[i].turn_entered);
-        if (added < 0 || added >= rem)
-            break;
-        off += added;
-    }
-    // append battlefield permanents ids
-    for (int i = 0; i < s->battlefield_permanent_count && off < out_size - 1; ++i)
-    {
-        int rem = out_size - off;
-        int added = snprintf(out + off, rem, ",P%d", s->battlefield_permanents[i]);
-        if (added < 0 || added >= rem)
-            break;
-        off += added;
-    }
-
-    // append library information (size and remaining ids) so state identity
-    // includes library contents which affect future draws
-    if (off < out_size - 1)
-    {
-        int rem = out_size - off;
-        int added = snprintf(out + off, rem, ",LIB%d", s->library_size);
-        if (added > 0 && added < rem)
-            off += added;
-    }
-    for (int i = 0; i < s->library_size && off < out_size - 1; ++i)
-    {
-        int rem = out_size - off;
-        int added = snprintf(out + off, rem, ",%d", s->library[i]);
-        if (added < 0 || added >= rem)
-            break;
-        off += added;
-    }
+void solver_scratch_init(SolverScratch *scratch)
+{
+    memset(&scratch->metrics, 0, sizeof(scratch->metrics));
+    // 4 MB chunks; keep up to 256 MB per worker between hands
+    arena_init(&scratch->arena, (size_t)4 << 20, (size_t)256 << 20);
+}
 
-    // ensure NUL termination
-    if (out_size > 0)
-        out[out_size - 1] = '\0';
+void solver_scratch_free(SolverScratch *scratch)
+{
+    arena_free(&scratch->arena);
 }
 
-int bfs_solve(const GameState *start, int max_turns, char *seq_out, int seq_out_size)
+// ---------------------------------------------------------------------------
+// Shortest-kill search
+
+// Fixed-size, always-replace table of states already searched: for `key`
+// with turn limit `turn_limit`, every winning line of at most `depth` more
+// actions has been found (so when looking for one line, there is none).
+typedef struct KillEntry
 {
-    // simple queue
-    const int MAX_NODES = 20000;
-    GameState *q_states = malloc(sizeof(GameState) * MAX_NODES);
-    char (*q_seq)[MAX_SEQ_LEN] = malloc(MAX_NODES * MAX_SEQ_LEN);
-    int q_head = 0, q_tail = 0;
+    uint64_t key;
+    int32_t turn_limit;
+    int32_t depth;
+} KillEntry;
+
+#define KILL_TABLE_BITS 20
 
-    char (*visited)[512] = malloc(MAX_NODES * 512);
-    int visited_cnt = 0;
+// Search state. The line being explored is kept as a stack of action codes
+// and copied out only when it wins; nothing is formatted during the search.
+typedef struct KillSearch
+{
+    KillEntry *table;
+    int turn_limit;
+    int cutoff; // set when some line was cut off by the depth limit
+    long long nodes;
+    int ply;
+    Action path[MAX_KILL_DEPTH];
+    MoveHistory history; // moves of the winning lines found so far
+    KillResult *results; // winning lines found so far, best first
+    uint64_t *win_keys;  // final state of each, to keep lines distinct
+    int found;
+    int want;
+} KillSearch;
+
+// resolve n draws from the known top of the library
+static void draw_known(GameState *s, int n)
+{
+    for (int i = 0; i < n && s->library_top_count > 0; ++i)
+        draw_card(s, -1);
+}
 
-    // push start
-    clone_state(start, &q_states[q_tail]);
-    q_seq[q_tail][0] = '\0';
-    q_tail++;
+// apply one action in kill-search semantics; returns 0 on success
+static int apply_action(GameState *s, Action a)
+{
+    switch (a.type)
+    {
+    case ACT_PLAY:
+        if (play_card(s, a.arg) != 0)
+            return -1;
+        draw_known(s, take_pending_draws(s));
+        return 0;
+    case ACT_TAP:
+        return tap_land_color(s, a.arg);
+    case ACT_END_TURN:
+        begin_next_turn(s);
+        draw_known(s, 1);
+        return 0;
+    }
+    return -1;
+}
 
-    while (q_head < q_tail && q_tail < MAX_NODES)
+// record the current path as a winning line unless it ends in a state an
+// earlier line already reached (i.e. it is only a reordering of that line)
+static void record_kill(KillSearch *ks, const GameState *s)
+{
+    for (int i = 0; i < ks->found; ++i)
     {
-        GameState cur = q_states[q_head];
-        char curseq[MAX_SEQ_LEN];
-        strncpy(curseq, q_seq[q_head], MAX_SEQ_LEN - 1);
-        curseq[MAX_SEQ_LEN - 1] = '\0';
-        q_head++;
+        if (ks->win_keys[i] == s->key)
+            return;
+    }
+    KillResult *r = &ks->results[ks->found];
+    r->found = 1;
+    r->kill_turn = s->turn;
+    r->actions = ks->ply;
+    memcpy(r->line, ks->path, sizeof(Action) * ks->ply);
+    ks->win_keys[ks->found++] = s->key;
+}
 
-        // check win
-        if (check_win(&cur))
-        {
-            strncpy(seq_out, curseq, seq_out_size - 1);
-            seq_out[seq_out_size - 1] = '\0';
-            // free any dynamically allocated library arrays inside queued states
-            for (int i = 0; i < q_tail; ++i)
-            {
-                if (q_states[i].library)
-                    free(q_states[i].library);
-            }
-            free(q_states);
-            free(q_seq);
-            free(visited);
-            return 1;
-        }
+// Lower bound on the actions still needed to win: one end turn per turn
+// left, plus the fewest payoff casts that could deal the remaining life. The
+// k-th cast from here deals at most storm + k for the current storm count,
+// on this turn or any later one, since storm only falls when a turn ends;
+// assuming a smaller storm for casts made now would overestimate.
+static int actions_lower_bound(const GameState *s, int turn_limit)
+{
+    int turns_left = turn_limit - s->turn;
+    int storm = s->storm_count;
+    int plays = 0;
+    for (int dealt = 0; dealt < s->opponent_life; dealt += storm + plays)
+        ++plays;
+    return turns_left + plays;
+}
 
-        if (cur.turn > max_turns)
-            continue;
+// Returns 1 once ks->want distinct lines have been found.
+static int kill_dfs(KillSearch *ks, const GameState *s, int depth_left)
+{
+    ks->nodes++;
+    if (check_win(s))
+    {
+        record_kill(ks, s);
+        return ks->found >= ks->want;
+    }
+    // on the last turn, states that cannot reach lethal are dead ends
+    if (s->turn == ks->turn_limit && damage_upper_bound(s) < s->opponent_life)
+        return 0;
+    // IDA*-style cut: the line cannot finish within the depth limit
+    if (depth_left < actions_lower_bound(s, ks->turn_limit))
+    {
+        ks->cutoff = 1;
+        return 0;
+    }
+    KillEntry *e = &ks->table[s->key & ((1u << KILL_TABLE_BITS) - 1)];
+    if (e->key == s->key && e->turn_limit == ks->turn_limit && e->depth >= depth_left)
+        return 0;
 
-        // serialize and check visited
-        char ser[512];
-        serialize_state(&cur, ser, sizeof(ser));
-        int seen = 0;
-        for (int i = 0; i < visited_cnt; ++i)
-            if (strcmp(visited[i], ser) == 0)
-            {
-                seen = 1;
-                break;
-            }
-        if (seen)
+    Action acts[MAX_MOVES];
+    int n = generate_moves(s, &default_move_order, &ks->history, s->turn < ks->turn_limit, acts);
+    for (int i = 0; i < n; ++i)
+    {
+        GameState next;
+        clone_state(s, &next);
+        if (apply_action(&next, acts[i]) != 0)
             continue;
-        if (visited_cnt < MAX_NODES)
-            strncpy(visited[visited_cnt++], ser, 511);
-
-        // 1) Try playing every playable card in hand
-        for (int i = 0; i < cur.hand_count; ++i)
-        {
-            if (cur.hand_used[i])
-                continue;
-            int cid = cur.hand_ids[i];
-            const Card *c = &cur.card_pool[cid];
-            if (!can_pay_cost(&cur, c))
-                continue;
+        int found_before = ks->found;
+        ks->path[ks->ply++] = acts[i];
+        int done = kill_dfs(ks, &next, depth_left - 1);
+        ks->ply--;
+        if (ks->found > found_before)
+            history_record(&ks->history, s, acts[i]);
+        if (done)
+            return 1;
+    }
 
-            GameState next;
-            clone_state(&cur, &next);
-            int ok = play_card(&next, i);
-            if (ok == 0)
-            {
-                // append to seq
-                char nseq[MAX_SEQ_LEN];
-                int off2 = snprintf(nseq, MAX_SEQ_LEN, "%sPlay: Turn%d %s\n", curseq, cur.turn, c->name);
-                if (off2 < 0)
-                    off2 = 0;
-                if (off2 >= MAX_SEQ_LEN)
-                    off2 = MAX_SEQ_LEN - 1;
-                // append any draws that occurred as part of this play
-                for (int d = 0; d < next.last_drawn_count && off2 < MAX_SEQ_LEN - 1; ++d)
-                {
-                    int dcid = next.last_drawn_ids[d];
-                    const char *dname = (dcid >= 0 && dcid < next.card_pool_size && next.card_pool[dcid].name) ? next.card_pool[dcid].name : "(null)";
-                    int remaining = MAX_SEQ_LEN - off2;
-                    int added = snprintf(nseq + off2, remaining, "Draw: Turn%d %s\n", cur.turn, dname);
-                    if (added < 0)
-                        break;
-                    if (added >= remaining)
-                    {
-                        off2 = MAX_SEQ_LEN - 1;
-                        break;
-                    }
-                    off2 += added;
-                }
-                // append any opponent life changes (recorded as deltas) caused by this action
-                {
-                    int life_now = cur.opponent_life;
-                    for (int o = 0; o < next.last_oplife_count && off2 < MAX_SEQ_LEN - 1; ++o)
-                    {
-                        int delta = next.last_oplife_deltas[o];
-                        int newlife = life_now + delta;
-                        int remaining = MAX_SEQ_LEN - off2;
-                        int added = snprintf(nseq + off2, remaining, "OppLife: %d -> %d\n", life_now, newlife);
-                        if (added < 0)
-                            break;
-                        if (added >= remaining)
-                        {
-                            off2 = MAX_SEQ_LEN - 1;
-                            break;
-                        }
-                        off2 += added;
-                        life_now = newlife;
-                    }
-                }
-                // push next
-                if (q_tail < MAX_NODES)
-                {
-                    clone_state(&next, &q_states[q_tail]);
-                    strncpy(q_seq[q_tail], nseq, MAX_SEQ_LEN - 1);
-                    q_seq[q_tail][MAX_SEQ_LEN - 1] = '\0';
-                    q_tail++;
-                }
-            }
-        }
+    e->key = s->key;
+    e->turn_limit = ks->turn_limit;
+    e->depth = depth_left;
+    return 0;
+}
 
-        // 1b) Try tapping an untapped land for each color
-        for (int color = 0; color < COLOR_COUNT; ++color)
-        {
-            if (cur.battlefield_lands[color] - cur.battlefield_lands_tapped[color] <= 0)
-                continue;
-            GameState next;
-            clone_state(&cur, &next);
-            int ok = tap_land_color(&next, color);
-            if (ok == 0)
-            {
-                char nseq[MAX_SEQ_LEN];
-                int off2 = snprintf(nseq, MAX_SEQ_LEN, "%sTap %s: Turn%d -> +1 %s\n", curseq, color_name(color), cur.turn, color_name(color));
-                if (off2 < 0)
-                    off2 = 0;
-                if (off2 >= MAX_SEQ_LEN)
-                    off2 = MAX_SEQ_LEN - 1;
-                // append any draws produced by triggered abilities (unlikely on tap)
-                for (int d = 0; d < next.last_drawn_count && off2 < MAX_SEQ_LEN - 1; ++d)
-                {
-                    int dcid = next.last_drawn_ids[d];
-                    const char *dname = (dcid >= 0 && dcid < next.card_pool_size && next.card_pool[dcid].name) ? next.card_pool[dcid].name : "(null)";
-                    int remaining = MAX_SEQ_LEN - off2;
-                    int added = snprintf(nseq + off2, remaining, "Draw: Turn%d %s\n", cur.turn, dname);
-                    if (added < 0)
-                        break;
-                    if (added >= remaining)
-                    {
-                        off2 = MAX_SEQ_LEN - 1;
-                        break;
-                    }
-                    off2 += added;
-                }
-                // append any opponent life changes (recorded as deltas) caused by this action
-                {
-                    int life_now = cur.opponent_life;
-                    for (int o = 0; o < next.last_oplife_count && off2 < MAX_SEQ_LEN - 1; ++o)
-                    {
-                        int delta = next.last_oplife_deltas[o];
-                        int newlife = life_now + delta;
-                        int remaining = MAX_SEQ_LEN - off2;
-                        int added = snprintf(nseq + off2, remaining, "OppLife: %d -> %d\n", life_now, newlife);
-                        if (added < 0)
-                            break;
-                        if (added >= remaining)
-                        {
-                            off2 = MAX_SEQ_LEN - 1;
-                            break;
-                        }
-                        off2 += added;
-                        life_now = newlife;
-                    }
-                }
-                if (q_tail < MAX_NODES)
-                {
-                    clone_state(&next, &q_states[q_tail]);
-                    strncpy(q_seq[q_tail], nseq, MAX_SEQ_LEN - 1);
-                    q_seq[q_tail][MAX_SEQ_LEN - 1] = '\0';
-                    q_tail++;
-                }
-            }
-        }
+static double now_seconds(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
 
-        // 2) End turn: advance to next turn and set mana = permanent_mana
-        if (cur.turn < max_turns)
+int solve_top_kills(SolverScratch *scratch, const GameState *start, int max_turns, KillResult *results, int k)
+{
+    double t0 = now_seconds();
+    if (k <= 0)
+        return 0;
+    memset(results, 0, sizeof(KillResult) * k);
+
+    KillSearch ks;
+    memset(&ks, 0, sizeof(ks));
+    arena_reset(&scratch->arena);
+    ks.table = arena_calloc(&scratch->arena, (size_t)1 << KILL_TABLE_BITS, sizeof(KillEntry));
+    ks.win_keys = arena_alloc(&scratch->arena, sizeof(uint64_t) * k);
+    if (!ks.table || !ks.win_keys)
+        return 0;
+    ks.results = results;
+    ks.want = k;
+
+    GameState s0;
+    clone_state(start, &s0);
+    state_rekey(&s0);
+
+    // Deepen on the kill turn first, then on line length within that turn,
+    // so lines are found best first: every line of the current length was
+    // already found by an earlier iteration. A turn limit is exhausted once
+    // an iteration finishes without any line being cut off by the depth
+    // limit.
+    int done = 0;
+    for (int turn = s0.turn; turn <= max_turns && !done; ++turn)
+    {
+        ks.turn_limit = turn;
+        for (int depth = turn - s0.turn + 1; depth <= MAX_KILL_DEPTH; ++depth)
         {
-            GameState next;
-            clone_state(&cur, &next);
-            next.turn = cur.turn + 1;
-            // untap all lands at the beginning of next turn and reset land-play flag
-            for (int i = 0; i < COLOR_COUNT; ++i)
-            {
-                // untap lands
-                next.battlefield_lands_tapped[i] = 0;
-                next.land_played_this_turn = 0;
-                // player mana starts empty; lands must be tapped to add mana
-                next.player_mana[i] = 0;
-            }
-            // reset storm count at the beginning of a new turn
-            next.storm_count = 0;
-            // draw a card at the beginning of each turn except the first
-            if (next.turn > 1)
-            {
-                draw_card(&next, -1);
-            }
-            char nseq[MAX_SEQ_LEN];
-            int off2 = snprintf(nseq, MAX_SEQ_LEN, "%sEndTurn -> Turn %d\n", curseq, next.turn);
-            if (off2 < 0)
-                off2 = 0;
-            if (off2 >= MAX_SEQ_LEN)
-                off2 = MAX_SEQ_LEN - 1;
-            // include any draws recorded (start-of-turn and triggered draws)
-            for (int d = 0; d < next.last_drawn_count && off2 < MAX_SEQ_LEN - 1; ++d)
-            {
-                int dcid = next.last_drawn_ids[d];
-                const char *dname = (dcid >= 0 && dcid < next.card_pool_size && next.card_pool[dcid].name) ? next.card_pool[dcid].name : "(null)";
-                int remaining = MAX_SEQ_LEN - off2;
-                int added = snprintf(nseq + off2, remaining, "Draw: Turn%d %s\n", next.turn, dname);
-                if (added < 0)
-                    break;
-                if (added >= remaining)
-                {
-                    off2 = MAX_SEQ_LEN - 1;
-                    break;
-                }
-                off2 += added;
-            }
-            // append any opponent life changes (recorded as deltas) caused at end of turn
-            {
-                int life_now = cur.opponent_life;
-                for (int o = 0; o < next.last_oplife_count && off2 < MAX_SEQ_LEN - 1; ++o)
-                {
-                    int delta = next.last_oplife_deltas[o];
-                    int newlife = life_now + delta;
-                    int remaining = MAX_SEQ_LEN - off2;
-                    int added = snprintf(nseq + off2, remaining, "OppLife: %d -> %d\n", life_now, newlife);
-                    if (added < 0)
-                        break;
-                    if (added >= remaining)
-                    {
-                        off2 = MAX_SEQ_LEN - 1;
-                        break;
-                    }
-                    off2 += added;
-                    life_now = newlife;
-                }
-            }
-            if (q_tail < MAX_NODES)
-            {
-                clone_state(&next, &q_states[q_tail]);
-                strncpy(q_seq[q_tail], nseq, MAX_SEQ_LEN - 1);
-                q_seq[q_tail][MAX_SEQ_LEN - 1] = '\0';
-                q_tail++;
-            }
+            ks.cutoff = 0;
+            ks.ply = 0;
+            done = kill_dfs(&ks, &s0, depth);
+            if (done || !ks.cutoff)
+                break;
         }
     }
-    // free any dynamically allocated library arrays inside queued states
-    for (int i = 0; i < q_tail; ++i)
+
+    double seconds = now_seconds() - t0;
+    for (int i = 0; i < k; ++i)
     {
-        if (q_states[i].library)
-            free(q_states[i].library);
+        results[i].nodes = ks.nodes;
+        results[i].seconds = seconds;
     }
-    free(q_states);
-    free(q_seq);
-    free(visited);
-    return 0;
+    return ks.found;
 }
 
-// Helper: add or accumulate a state in the visited list.
-struct ProbEntry
+int solve_fastest_kill(SolverScratch *scratch, const GameState *start, int max_turns, KillResult *result)
 {
-    char ser[512];
-    GameState state;
-    double prob;
-    int processed;
-};
+    return solve_top_kills(scratch, start, max_turns, result, 1);
+}
 
-static int find_ser(struct ProbEntry *arr, int cnt, const char *ser)
+// append printf-style text at *off, clamping at the end of the buffer
+static void append_text(char *out, int out_size, int *off, const char *fmt, ...)
 {
-    for (int i = 0; i < cnt; ++i)
-        if (strcmp(arr[i].ser, ser) == 0)
-            return i;
-    return -1;
+    if (*off >= out_size - 1)
+        return;
+    va_list ap;
+    va_start(ap, fmt);
+    int r = vsnprintf(out + *off, (size_t)(out_size - *off), fmt, ap);
+    va_end(ap);
+    if (r < 0)
+        return;
+    *off = r >= out_size - *off ? out_size - 1 : *off + r;
 }
 
-static void enqueue_state(struct ProbEntry **arrp, int *cntp, int *cap, const GameState *s, const char *ser, double prob)
+void format_kill_line(const GameState *start, const KillResult *result, char *out, int out_size)
 {
-    int idx = find_ser(*arrp, *cntp, ser);
-    if (idx >= 0)
-    {
-        (*arrp)[idx].prob += prob;
+    int off = 0;
+    if (out_size <= 0)
         return;
-    }
-    if (*cntp >= *cap)
+    out[0] = '\0';
+    GameState cur;
+    clone_state(start, &cur);
+    state_rekey(&cur);
+    for (int i = 0; i < result->actions; ++i)
     {
-        int ncap = (*cap) ? (*cap) * 2 : 1024;
-        *arrp = realloc(*arrp, sizeof(struct ProbEntry) * ncap);
-        *cap = ncap;
+        Action a = result->line[i];
+        GameState next;
+        clone_state(&cur, &next);
+        if (apply_action(&next, a) != 0)
+            break;
+        if (a.type == ACT_PLAY)
+            append_text(out, out_size, &off, "Play: Turn%d %s\n", cur.turn, cur.card_pool[cur.hand_ids[a.arg]].name);
+        else if (a.type == ACT_TAP)
+            append_text(out, out_size, &off, "Tap %s: Turn%d -> +1 %s\n", color_name(a.arg), cur.turn, color_name(a.arg));
+        else
+            append_text(out, out_size, &off, "EndTurn -> Turn %d\n", next.turn);
+        for (int d = 0; d < next.last_drawn_count; ++d)
+            append_text(out, out_size, &off, "Draw: Turn%d %s\n", next.turn, next.card_pool[next.last_drawn_ids[d]].name);
+        int life = cur.opponent_life;
+        for (int o = 0; o < next.last_oplife_count; ++o)
+        {
+            append_text(out, out_size, &off, "OppLife: %d -> %d\n", life, life + next.last_oplife_deltas[o]);
+            life += next.last_oplife_deltas[o];
+        }
+        cur = next;
     }
-    struct ProbEntry *e = &(*arrp)[(*cntp)++];
-    strncpy(e->ser, ser, sizeof(e->ser) - 1);
-    e->ser[sizeof(e->ser) - 1] = '\0';
-    clone_state(s, &e->state);
-    e->prob = prob;
-    e->processed = 0;
 }
 
-// Recursively branch pending draws from a base state. Each draw splits
-// probability by the current library size. When draws_left == 0, the final
-// state is enqueued into arr with accumulated prob.
-static void branch_draws_and_enqueue(struct ProbEntry **arrp, int *cntp, int *cap, const GameState *base, int draws_left, double prob)
+// Probabilistic solver. The value of a state is the probability of winning
+// from it with best play: the maximum over the player's actions, and the
+// average over equally likely library cards at each draw. Values are
+// memoised in a transposition table keyed by the state key, so a state that
+// is reached along several lines is solved once.
+typedef struct ProbSolver
 {
-    if (draws_left <= 0)
+    StateTable memo;
+    int max_turns;
+    atomic_int *progress_counter;
+    SolverMetrics *metrics;
+} ProbSolver;
+
+static double solve_state(ProbSolver *ps, const GameState *s);
+
+static int free_hand_slots(const GameState *s)
+{
+    int n = 0;
+    for (int i = 0; i < s->hand_count; ++i)
+        n += s->hand_used[i];
+    return n;
+}
+
+// Average over the outcomes of `draws` draws from s's library, then solve.
+// Known top cards are drawn first with certainty. The rest are grouped by
+// distinct card id: when every drawn card fits in the hand, the outcomes are
+// the unordered multisets of the drawn cards with their hypergeometric
+// weights; otherwise draw order decides which card overflows to the
+// graveyard, so we branch one draw at a time over distinct ids weighted by
+// remaining count.
+static double solve_draws(ProbSolver *ps, const GameState *s, int draws)
+{
+    if (draws > s->library_size)
+        draws = s->library_size;
+    if (draws <= 0)
+        return solve_state(ps, s);
+    if (s->library_top_count > 0)
     {
-        char ser[512];
-        serialize_state(base, ser, sizeof(ser));
-        enqueue_state(arrp, cntp, cap, base, ser, prob);
-        return;
+        GameState tmp;
+        clone_state(s, &tmp);
+        draw_card(&tmp, -1);
+        return solve_draws(ps, &tmp, draws - 1);
     }
-    int L = base->library_size;
-    if (L <= 0)
+
+    metric_add(&ps->metrics->chance_nodes, 1);
+    int L = s->library_size;
+    HandIter it;
+    hand_iter_init_counts(&it, s->library_counts, MAX_CARD_IDS, draws);
+    double sum = 0.0;
+
+    if (draws == 1 || free_hand_slots(s) >= draws)
     {
-        // no cards to draw: nothing happens
-        char ser[512];
-        serialize_state(base, ser, sizeof(ser));
-        enqueue_state(arrp, cntp, cap, base, ser, prob);
-        return;
+        int ids[MAX_HAND];
+        while (hand_iter_next(&it))
+        {
+            GameState tmp;
+            clone_state(s, &tmp);
+            int n = hand_iter_ids(&it, ids);
+            for (int d = 0; d < n; ++d)
+                draw_card(&tmp, ids[d]);
+            sum += hand_iter_weight(&it) * solve_state(ps, &tmp);
+        }
+        return sum;
     }
-    for (int i = 0; i < L; ++i)
+
+    for (int i = 0; i < it.ndistinct; ++i)
     {
         GameState tmp;
-        clone_state(base, &tmp);
-        int cid = draw_card(&tmp, i);
-        (void)cid;
-        // after the draw, continue branching remaining draws
-        branch_draws_and_enqueue(arrp, cntp, cap, &tmp, draws_left - 1, prob / (double)L);
-        // free tmp.library allocated by clone_state
-        if (tmp.library)
-            free(tmp.library);
+        clone_state(s, &tmp);
+        draw_card(&tmp, it.ids[i]);
+        sum += (double)it.copies[i] / (double)L * solve_draws(ps, &tmp, draws - 1);
     }
+    return sum;
 }
 
-double solve_hand_probability(const GameState *start, int max_turns, atomic_int *progress_counter)
+static double solve_state(ProbSolver *ps, const GameState *s)
 {
-    struct ProbEntry *nodes = NULL;
-    int ncnt = 0;
-    int ncap = 0;
-
-    // seed with the start state having probability 1.0
-    char ser0[512];
-    serialize_state(start, ser0, sizeof(ser0));
-    enqueue_state(&nodes, &ncnt, &ncap, start, ser0, 1.0);
-
-    double win_prob = 0.0;
-
-    // process until no unprocessed entries remain
-    while (1)
+    if (check_win(s))
+        return 1.0;
+    if (s->turn > ps->max_turns)
+        return 0.0;
+    if (s->turn == ps->max_turns && damage_upper_bound(s) < s->opponent_life)
     {
-        int cur_idx = -1;
-        for (int i = 0; i < ncnt; ++i)
-            if (!nodes[i].processed)
-            {
-                cur_idx = i;
-                break;
-            }
-        if (cur_idx < 0)
-            break;
-
-        struct ProbEntry node = nodes[cur_idx];
-        nodes[cur_idx].processed = 1;
-        GameState cur = node.state; // copy local
-        double prob = node.prob;
-
-        if (progress_counter)
-            atomic_fetch_add(progress_counter, 1);
+        metric_add(&ps->metrics->prunes, 1);
+        return 0.0;
+    }
+    StateEntry *hit = st_find(&ps->memo, s->key);
+    if (hit)
+    {
+        metric_add(&ps->metrics->tt_hits, 1);
+        return hit->value;
+    }
+    metric_add(&ps->metrics->tt_misses, 1);
+    metric_add(&ps->metrics->nodes, 1);
 
-        if (prob <= 0.0)
-        {
-            continue;
-        }
+    if (ps->progress_counter)
+        atomic_fetch_add(ps->progress_counter, 1);
 
-        if (check_win(&cur))
-        {
-            win_prob += prob;
-            continue;
-        }
-        if (cur.turn > max_turns)
-        {
-            continue;
-        }
+    double best = 0.0;
 
-        // 1) Try playing every playable card in hand
-        for (int i = 0; i < cur.hand_count; ++i)
+    // max over the player's moves: plays (whose draws resolve as a chance
+    // event), taps, and ending the turn (followed by the turn's draw)
+    Action moves[MAX_MOVES];
+    int n = generate_moves(s, &default_move_order, NULL, s->turn < ps->max_turns, moves);
+    int i;
+    for (i = 0; i < n && best < 1.0; ++i)
+    {
+        GameState next;
+        clone_state(s, &next);
+        double v;
+        if (moves[i].type == ACT_PLAY)
         {
-            if (cur.hand_used[i])
+            if (play_card(&next, moves[i].arg) != 0)
                 continue;
-            int cid = cur.hand_ids[i];
-            const Card *c = &cur.card_pool[cid];
-            if (!can_pay_cost(&cur, c))
-                continue;
-
-            GameState next;
-            clone_state(&cur, &next);
-            int ok = play_card(&next, i);
-            if (ok == 0)
-            {
-                // if abilities requested draws, branch them deterministically
-                if (next.pending_draws > 0)
-                {
-                    branch_draws_and_enqueue(&nodes, &ncnt, &ncap, &next, next.pending_draws, prob);
-                }
-                else
-                {
-                    char ser[512];
-                    serialize_state(&next, ser, sizeof(ser));
-                    enqueue_state(&nodes, &ncnt, &ncap, &next, ser, prob);
-                }
-            }
-            if (next.library)
-                free(next.library);
+            v = solve_draws(ps, &next, take_pending_draws(&next));
         }
-
-        // 1b) Try tapping an untapped land for each color
-        for (int color = 0; color < COLOR_COUNT; ++color)
+        else if (moves[i].type == ACT_TAP)
         {
-            if (cur.battlefield_lands[color] - cur.battlefield_lands_tapped[color] <= 0)
+            if (tap_land_color(&next, moves[i].arg) != 0)
                 continue;
-            GameState next;
-            clone_state(&cur, &next);
-            int ok = tap_land_color(&next, color);
-            if (ok == 0)
-            {
-                char ser[512];
-                serialize_state(&next, ser, sizeof(ser));
-                enqueue_state(&nodes, &ncnt, &ncap, &next, ser, prob);
-            }
-            if (next.library)
-                free(next.library);
+            v = solve_state(ps, &next);
         }
-
-        // 2) End turn: advance to next turn and set mana = permanent_mana
-        if (cur.turn < max_turns)
+        else
         {
-            GameState next;
-            clone_state(&cur, &next);
-            next.turn = cur.turn + 1;
-            for (int i = 0; i < COLOR_COUNT; ++i)
-            {
-                next.battlefield_lands_tapped[i] = 0;
-                next.land_played_this_turn = 0;
-                next.player_mana[i] = 0;
-            }
-            next.storm_count = 0;
-            // draw a card at the beginning of each turn except the first
-            if (next.turn > 1 && next.library_size > 0)
-            {
-                int L = next.library_size;
-                for (int j = 0; j < L; ++j)
-                {
-                    GameState nd2;
-                    clone_state(&next, &nd2);
-                    draw_card(&nd2, j);
-                    if (nd2.pending_draws > 0)
-                    {
-                        branch_draws_and_enqueue(&nodes, &ncnt, &ncap, &nd2, nd2.pending_draws, prob / (double)L);
-                    }
-                    else
-                    {
-                        char ser[512];
-                        serialize_state(&nd2, ser, sizeof(ser));
-                        enqueue_state(&nodes, &ncnt, &ncap, &nd2, ser, prob / (double)L);
-                    }
-                    if (nd2.library)
-                        free(nd2.library);
-                }
-            }
-            else
-            {
-                // no draw
-                char ser[512];
-                serialize_state(&next, ser, sizeof(ser));
-                enqueue_state(&nodes, &ncnt, &ncap, &next, ser, prob);
-            }
-            if (next.library)
-                free(next.library);
+            begin_next_turn(&next);
+            v = solve_draws(ps, &next, 1);
         }
-
-        /* Do not free cur.library here: nodes array still owns the stored
-         * state's library pointer. Final cleanup will free all stored
-         * libraries once. */
+        if (v > best)
+            best = v;
     }
+    if (i < n)
+        metric_add(&ps->metrics->prunes, 1);
+
+    int found = 0;
+    StateEntry *e = st_insert(&ps->memo, s->key, &found);
+    if (e)
+        e->value = best;
+    metric_max(&ps->metrics->peak_table, ps->memo.count);
+    return best;
+}
 
-    // cleanup stored states
-    for (int i = 0; i < ncnt; ++i)
-    {
-        if (nodes[i].state.library)
-            free(nodes[i].state.library);
-    }
-    free(nodes);
+double solve_hand_probability(const GameState *start, int max_turns, atomic_int *progress_counter)
+{
+    SolverScratch scratch;
+    solver_scratch_init(&scratch);
+    double p = solve_hand_probability_with(&scratch, start, max_turns, progress_counter);
+    solver_scratch_free(&scratch);
+    return p;
+}
 
-    return win_prob;
+double solve_hand_probability_with(SolverScratch *scratch, const GameState *start, int max_turns, atomic_int *progress_counter)
+{
+    ProbSolver ps;
+    ps.max_turns = max_turns;
+    ps.progress_counter = progress_counter;
+    ps.metrics = &scratch->metrics;
+    // the previous hand's table is dropped in bulk with the arena
+    arena_reset(&scratch->arena);
+    if (st_init_arena(&ps.memo, &scratch->arena, 1 << 16) != 0)
+        return 0.0;
+
+    GameState s0;
+    clone_state(start, &s0);
+    state_rekey(&s0);
+    return solve_state(&ps, &s0);
 }
@@ -2,8 +2,11 @@
 #define GAME_H
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdatomic.h>
 #include "card.h"
+#include "arena.h"
+#include "metrics.h"
 
 #define MAX_HAND 7
 #define MAX_SEQ_LEN 1024
@@ -11,6 +14,12 @@
 #define GRAVEYARD_MAX 64
 // max permanents (artifacts/creatures/enchantments) tracked on battlefield
 #define MAX_PERMANENTS 64
+// card ids the library count vector can track (card pool size limit)
+#define MAX_CARD_IDS 32
+// max known cards held in order on top of the library
+#define LIBRARY_TOP_MAX 16
+// longest action line the shortest-kill search will explore
+#define MAX_KILL_DEPTH 64
 // graveyard entry reasons
 enum GraveReason
 {
@@ -50,12 +59,19 @@ typedef struct GameState
     // battlefield permanents (card ids)
     int battlefield_permanent_count;
     int battlefield_permanents[MAX_PERMANENTS];
-    // library (deck) for drawing: dynamic array of card ids remaining in library
-    // draw_card will remove entries from this array and decrement library_size
-    int *library;
+    // generic cost reduction per SpellClass, summed over the cost modifiers
+    // of the permanents above; derived from them, so not part of the key
+    int cost_reduction[SPELL_CLASS_COUNT];
+    // library (deck) for drawing, stored inline so cloning a state is a plain
+    // struct copy: per-card-id counts of the unknown part of the library plus
+    // an ordered prefix of known top cards (library_top[0] is drawn first).
+    // library_size counts both parts.
+    uint8_t library_counts[MAX_CARD_IDS];
+    int library_top[LIBRARY_TOP_MAX];
+    int library_top_count;
     int library_size;
     // transient list of card ids drawn as part of the last action on this state
-    // used by bfs_solve to log draw events. Cleared when cloning from another state.
+    // used when printing a line to log draw events. Cleared when cloning from another state.
     int last_drawn_ids[8];
     int last_drawn_count;
     // transient opponent life change deltas recorded during the last action
@@ -64,15 +80,50 @@ typedef struct GameState
     // number of draws requested by abilities that should be resolved by the
     // solver as branching events (allows exact probabilistic solving).
     int pending_draws;
+    // 64-bit state key, maintained incrementally by every mutator below: the
+    // wrapping sum of one hash term per scalar field value and one per card
+    // in each zone, so zones hash as multisets (card order and hand slot
+    // positions do not matter). Transient logs and player_life are excluded.
+    uint64_t key;
 } GameState;
 
 // utility
 void print_state(const GameState *s);
 void clone_state(const GameState *src, GameState *dst);
 
+// Recompute the state key from scratch. Call after filling a GameState by
+// hand; the solvers do this for their start state.
+uint64_t state_key(const GameState *s);
+void state_rekey(GameState *s);
+
+// Add (or with a negative amount, remove) mana of one color.
+void add_mana(GameState *s, int color, int amount);
+
+// Ask the solver to resolve n draws as a chance event after this action.
+void request_draws(GameState *s, int n);
+
+// Clear and return the pending draw count.
+int take_pending_draws(GameState *s);
+
+// Move to the next turn: untap lands, empty the mana pool, reset storm and
+// the land drop. The turn's draw is left to the caller so solvers can
+// branch on it.
+void begin_next_turn(GameState *s);
+
 // Apply playing the card at hand_index; returns 0 on success, -1 if can't play
 int play_card(GameState *s, int hand_index);
 
+// Bitmask of the hand slots that can be played right now (bit i = hand
+// slot i): affordable spells, plus lands while the land drop is unused.
+// Computed in one pass over the hand.
+uint32_t playable_mask(const GameState *s);
+
+// Optimistic (never too low) estimate of the damage the player can still
+// deal this turn from s, from the mana available, the net mana of the
+// rituals and cantrip-reachable cards, the storm count and the payoffs. Used
+// by the solvers to drop last-turn states that cannot reach lethal.
+int damage_upper_bound(const GameState *s);
+
 // Tap an untapped land of a given color for 1 mana. color is ManaColor (0..2).
 // Returns 0 on success, -1 if no untapped land of that color.
 int tap_land_color(GameState *s, int color);
@@ -80,30 +131,102 @@ int tap_land_color(GameState *s, int color);
 // Check win: opponent_life <= 0
 int check_win(const GameState *s);
 
-// Draw a card from the GameState library into the hand. Returns 0 on success,
-// -1 on failure (empty library or no slot). The draw is performed by removing
-// a random card from the library using rand(). If the hand is full, the drawn
-// card is placed into the graveyard.
-// Draw a card from the GameState library into the hand. If idx >= 0, draw
-// the card at that library index; if idx == -1, choose a random card (legacy
-// behavior). Returns the card id drawn on success, -1 on failure.
-int draw_card(GameState *s, int idx);
+// Put card cid onto the battlefield as a permanent, folding its static cost
+// modifier into the state. Returns 0 on success, -1 if the battlefield is full.
+int add_permanent(GameState *s, int cid);
+
+// Remove the permanent at battlefield index (e.g. when sacrificed), undoing
+// its cost modifier. The last permanent takes its slot. Returns its card id,
+// or -1 for a bad index.
+int remove_permanent(GameState *s, int index);
+
+// Add one copy of card cid to the unknown part of the library.
+void library_add(GameState *s, int cid);
+
+// Move one copy of cid from the unknown part of the library to the bottom of
+// the known top-card prefix (e.g. after a scry). Returns 0 on success, -1 if
+// no copy is left or the prefix is full.
+int library_put_top(GameState *s, int cid);
+
+// Draw a card from the GameState library into the hand. If known top cards
+// exist, the first of them is drawn and cid is ignored. Otherwise cid >= 0
+// draws one copy of that card (the solver picks it when branching) and
+// cid == -1 chooses a random card (legacy behavior). If the hand is full,
+// the drawn card is placed into the graveyard. Returns the card id drawn on
+// success, -1 on failure.
+int draw_card(GameState *s, int cid);
 
 // Change opponent life by delta (can be negative). Records the delta in the
 // transient last_oplife_deltas array so BFS can log each change as it happens.
 void change_opponent_life(GameState *s, int delta);
 
-// BFS solver: searches for shortest sequence of plays (within max_turns) that lead to win.
-// If found, fills seq_out with a human-readable description and returns 1. Otherwise 0.
-int bfs_solve(const GameState *start, int max_turns, char *seq_out, int seq_out_size);
+// Per-worker solver scratch memory. Frontiers and transposition tables are
+// carved out of the arena and released in bulk when the next solve starts,
+// so back-to-back hands reuse the same memory instead of malloc/free. The
+// probabilistic solver also counts its work into metrics, which accumulate
+// across every hand solved with this scratch.
+typedef struct SolverScratch
+{
+    Arena arena;
+    SolverMetrics metrics;
+} SolverScratch;
+
+void solver_scratch_init(SolverScratch *scratch);
+void solver_scratch_free(SolverScratch *scratch);
+
+// one player action, as stored on a search path
+enum ActionType
+{
+    ACT_PLAY = 0,    // arg = hand index
+    ACT_TAP = 1,     // arg = ManaColor of the land to tap
+    ACT_END_TURN = 2 // arg unused
+};
+
+typedef struct Action
+{
+    uint8_t type;
+    uint8_t arg;
+} Action;
+
+// result of a shortest-kill search
+typedef struct KillResult
+{
+    int found;       // 1 if a winning line exists within max_turns
+    int kill_turn;   // turn the opponent dies on
+    int actions;     // length of the line in actions
+    Action line[MAX_KILL_DEPTH];
+    long long nodes; // nodes searched across all iterations of the search
+    double seconds;  // wall time of the search
+} KillResult;
+
+// Shortest-kill solver: iterative-deepening depth-first search for the
+// fastest winning line from start, first by kill turn and then by number of
+// actions. Memory is the current path (at most MAX_KILL_DEPTH actions) plus
+// a fixed-size transposition table from the scratch arena that remembers
+// states already shown not to win within a given remaining depth.
+// Draws resolve from the known top of the library (see library_put_top);
+// once that runs out further draws are skipped, because an unknown card
+// cannot be planned around. Returns result->found.
+int solve_fastest_kill(SolverScratch *scratch, const GameState *start, int max_turns, KillResult *result);
+
+// Same search, continued until the k best distinct winning lines are found
+// (lines that only reorder the same actions count once). Fills results[0..k)
+// best first and returns how many were found.
+int solve_top_kills(SolverScratch *scratch, const GameState *start, int max_turns, KillResult *results, int k);
+
+// Write a human-readable replay of result's line (plays, taps, draws and
+// opponent life changes) into out.
+void format_kill_line(const GameState *start, const KillResult *result, char *out, int out_size);
 
 // Probabilistic solver: returns the exact probability (0..1) that the given
 // start state will lead to a win within max_turns, accounting for all possible
-// library draws (branching). This merges identical states by serialization to
-// keep the search tractable.
+// library draws (branching). Identical states are merged through a
+// transposition table keyed by the state key to keep the search tractable.
 // progress_counter: if non-NULL, the solver will atomically increment this
 // counter as it processes nodes; this allows the caller to display per-hand
 // progress. The counter should be unique per worker/thread.
 double solve_hand_probability(const GameState *start, int max_turns, atomic_int *progress_counter);
+// same, using the caller's (typically per-worker) scratch memory
+double solve_hand_probability_with(SolverScratch *scratch, const GameState *start, int max_turns, atomic_int *progress_counter);
 
 #endif // GAME_H
@@ -0,0 +1,125 @@
+#include "hands.h"
+#include <string.h>
+
+double choose(int n, int k)
+{
+    if (k < 0 || k > n)
+        return 0.0;
+    if (k > n - k)
+        k = n - k;
+    double r = 1.0;
+    for (int i = 1; i <= k; ++i)
+        r = r * (double)(n - k + i) / (double)i;
+    return r;
+}
+
+int hand_iter_init(HandIter *it, const int *deck, int deck_n, int hand_size)
+{
+    memset(it, 0, sizeof(*it));
+    it->deck_size = deck_n;
+    it->hand_size = hand_size;
+    // collapse the deck into ascending (id, copies) pairs
+    for (int i = 0; i < deck_n; ++i)
+    {
+        int id = deck[i];
+        int pos = 0;
+        while (pos < it->ndistinct && it->ids[pos] < id)
+            pos++;
+        if (pos < it->ndistinct && it->ids[pos] == id)
+        {
+            it->copies[pos]++;
+            continue;
+        }
+        if (it->ndistinct >= MAX_DISTINCT)
+        {
+            it->ndistinct = 0;
+            return -1;
+        }
+        memmove(&it->ids[pos + 1], &it->ids[pos], sizeof(int) * (it->ndistinct - pos));
+        memmove(&it->copies[pos + 1], &it->copies[pos], sizeof(int) * (it->ndistinct - pos));
+        it->ids[pos] = id;
+        it->copies[pos] = 1;
+        it->ndistinct++;
+    }
+    it->total_combos = choose(deck_n, hand_size);
+    return 0;
+}
+
+int hand_iter_init_counts(HandIter *it, const uint8_t *counts, int ncounts, int hand_size)
+{
+    memset(it, 0, sizeof(*it));
+    it->hand_size = hand_size;
+    for (int id = 0; id < ncounts; ++id)
+    {
+        if (!counts[id])
+            continue;
+        if (it->ndistinct >= MAX_DISTINCT)
+        {
+            it->ndistinct = 0;
+            return -1;
+        }
+        it->ids[it->ndistinct] = id;
+        it->copies[it->ndistinct] = counts[id];
+        it->ndistinct++;
+        it->deck_size += counts[id];
+    }
+    it->total_combos = choose(it->deck_size, hand_size);
+    return 0;
+}
+
+// fill take[from..] greedily left to right with `remaining` cards;
+// returns the number of cards that did not fit
+static int fill_from(HandIter *it, int from, int remaining)
+{
+    for (int i = from; i < it->ndistinct; ++i)
+    {
+        int t = remaining < it->copies[i] ? remaining : it->copies[i];
+        it->take[i] = t;
+        remaining -= t;
+    }
+    return remaining;
+}
+
+int hand_iter_next(HandIter *it)
+{
+    if (it->ndistinct == 0)
+        return 0;
+    if (!it->started)
+    {
+        it->started = 1;
+        return fill_from(it, 0, it->hand_size) == 0;
+    }
+    // Reverse-lexicographic successor: find the rightmost slot that can give
+    // one card to the slots after it, then refill those slots greedily.
+    int suffix_take = it->take[it->ndistinct - 1];
+    int suffix_room = it->copies[it->ndistinct - 1];
+    for (int i = it->ndistinct - 2; i >= 0; --i)
+    {
+        if (it->take[i] > 0 && suffix_room >= suffix_take + 1)
+        {
+            it->take[i]--;
+            fill_from(it, i + 1, suffix_take + 1);
+            return 1;
+        }
+        suffix_take += it->take[i];
+        suffix_room += it->copies[i];
+    }
+    return 0;
+}
+
+double hand_iter_weight(const HandIter *it)
+{
+    double w = 1.0;
+    for (int i = 0; i < it->ndistinct; ++i)
+        w *= choose(it->copies[i], it->take[i]);
+    return it->total_combos > 0.0 ? w / it->total_combos : 0.0;
+}
+
+int hand_iter_ids(const HandIter *it, int *ids_out)
+{
+    int n = 0;
+    for (int i = 0; i < it->ndistinct; ++i)
+        for (int c = 0; c < it->take[i]; ++c)
+            ids_out[n++] = it->ids[i];
+    return n;
+}
@@ -0,0 +1,49 @@
+#ifndef HANDS_H
+#define HANDS_H
+
+#include "game.h"
+
+// most distinct card ids a deck may contain
+#define MAX_DISTINCT 64
+
+// Enumerates the distinct opening hands of a deck as multisets of card ids.
+// The deck is reduced to (card id, copies) pairs and each hand is a vector
+// take[] with 0 <= take[i] <= copies[i] and sum(take) == hand_size, so a hand
+// that can be drawn in many orders or from many equal copies is produced
+// exactly once, together with its exact hypergeometric probability.
+typedef struct HandIter
+{
+    int ndistinct;
+    int ids[MAX_DISTINCT];    // card id of each distinct slot (ascending)
+    int copies[MAX_DISTINCT]; // copies of that card in the deck
+    int take[MAX_DISTINCT];   // current hand: copies of each card in hand
+    int deck_size;
+    int hand_size;
+    int started;
+    double total_combos; // C(deck_size, hand_size)
+} HandIter;
+
+// binomial coefficient as a double (exact for decks of any realistic size)
+double choose(int n, int k);
+
+// prepare an iterator over hand_size-card multisets of deck[0..deck_n).
+// Returns 0, or -1 if the deck has more than MAX_DISTINCT distinct ids, in
+// which case the iterator yields no hands (dropping a card would leave
+// weights that no longer sum to 1).
+int hand_iter_init(HandIter *it, const int *deck, int deck_n, int hand_size);
+
+// same, from a count vector: counts[id] copies of card id, for ids < ncounts
+int hand_iter_init_counts(HandIter *it, const uint8_t *counts, int ncounts, int hand_size);
+
+// advance to the next multiset; returns 1 while there is one, 0 when done.
+// The first call yields the first hand.
+int hand_iter_next(HandIter *it);
+
+// probability of drawing the current multiset: prod C(copies, take) / C(N, k)
+double hand_iter_weight(const HandIter *it);
+
+// write the current hand's card ids (sorted, with repeats) into ids_out;
+// returns the number written (hand_size)
+int hand_iter_ids(const HandIter *it, int *ids_out);
+
+#endif // HANDS_H
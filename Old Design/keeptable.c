@@ -0,0 +1,228 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "keeptable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+int keep_table_write(const char *path, const HandIter *shape, int max_turns, const float *probs)
+{
+    if (max_turns < 1 || max_turns > KEEP_TABLE_MAX_TURNS)
+    {
+        fprintf(stderr, "keep table: turn limit must be 1..%d\n", KEEP_TABLE_MAX_TURNS);
+        return -1;
+    }
+    HandIter it = *shape;
+    uint32_t nhands = 0;
+    it.started = 0;
+    while (hand_iter_next(&it))
+        ++nhands;
+
+    KeepTableHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, KEEP_TABLE_MAGIC, 4);
+    hdr.version = KEEP_TABLE_VERSION;
+    hdr.hand_size = (uint32_t)shape->hand_size;
+    hdr.max_turns = (uint32_t)max_turns;
+    hdr.ndistinct = (uint32_t)shape->ndistinct;
+    hdr.nhands = nhands;
+    hdr.entries_off = (uint32_t)sizeof(hdr);
+    hdr.size = hdr.entries_off + (uint32_t)(sizeof(float) * nhands * (size_t)max_turns);
+    for (int i = 0; i < shape->ndistinct; ++i)
+    {
+        hdr.ids[i] = (uint8_t)shape->ids[i];
+        hdr.copies[i] = (uint8_t)shape->copies[i];
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+    {
+        fprintf(stderr, "cannot write keep table %s\n", path);
+        return -1;
+    }
+    int ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+             fwrite(probs, sizeof(float) * (size_t)max_turns, nhands, f) == nhands;
+    if (fclose(f) != 0 || !ok)
+    {
+        fprintf(stderr, "error writing keep table %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// check the image and fill the lookup tables
+static int attach(KeepTable *t, void *image, size_t size)
+{
+    const KeepTableHeader *hdr = image;
+    if (size < sizeof(*hdr) || memcmp(hdr->magic, KEEP_TABLE_MAGIC, 4) != 0 ||
+        hdr->version != KEEP_TABLE_VERSION || hdr->size != size || hdr->ndistinct > MAX_DISTINCT ||
+        hdr->hand_size > MAX_HAND || hdr->max_turns == 0 ||
+        hdr->max_turns > KEEP_TABLE_MAX_TURNS || hdr->entries_off < sizeof(*hdr) ||
+        hdr->entries_off + sizeof(float) * (size_t)hdr->nhands * hdr->max_turns != size)
+    {
+        return -1;
+    }
+    t->hdr = hdr;
+    t->entries = (const float *)((const char *)image + hdr->entries_off);
+    t->image = image;
+    t->size = size;
+    for (int id = 0; id < MAX_CARD_IDS; ++id)
+        t->slot_of[id] = -1;
+    for (uint32_t i = 0; i < hdr->ndistinct; ++i)
+    {
+        if (hdr->ids[i] < MAX_CARD_IDS)
+            t->slot_of[hdr->ids[i]] = (int)i;
+    }
+    // ways[n][0] = 1; each slot may hold 0..copies of the cards left
+    int n = (int)hdr->ndistinct;
+    memset(t->ways, 0, sizeof(t->ways));
+    t->ways[n][0] = 1.0;
+    for (int i = n - 1; i >= 0; --i)
+    {
+        for (int r = 0; r <= (int)hdr->hand_size; ++r)
+        {
+            for (int v = 0; v <= hdr->copies[i] && v <= r; ++v)
+                t->ways[i][r] += t->ways[i + 1][r - v];
+        }
+    }
+    return 0;
+}
+
+int keep_table_open(KeepTable *t, const char *path)
+{
+    memset(t, 0, sizeof(*t));
+    void *image = NULL;
+    size_t size = 0;
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "cannot open keep table %s\n", path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        fprintf(stderr, "cannot read keep table %s\n", path);
+        return -1;
+    }
+    size = (size_t)st.st_size;
+    image = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED)
+    {
+        fprintf(stderr, "cannot map keep table %s\n", path);
+        return -1;
+    }
+    t->mapped = 1;
+#else
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        fprintf(stderr, "cannot open keep table %s\n", path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    image = len > 0 ? malloc((size_t)len) : NULL;
+    size = (size_t)len;
+    if (!image || fread(image, 1, size, f) != size)
+    {
+        free(image);
+        fclose(f);
+        fprintf(stderr, "cannot read keep table %s\n", path);
+        return -1;
+    }
+    fclose(f);
+#endif
+    int mapped = t->mapped;
+    if (attach(t, image, size) != 0)
+    {
+#ifndef _WIN32
+        munmap(image, size);
+#else
+        free(image);
+#endif
+        memset(t, 0, sizeof(*t));
+        fprintf(stderr, "%s is not a keep table for this build\n", path);
+        return -1;
+    }
+    t->mapped = mapped;
+    return 0;
+}
+
+void keep_table_close(KeepTable *t)
+{
+    if (!t->image)
+        return;
+#ifndef _WIN32
+    if (t->mapped)
+        munmap(t->image, t->size);
+    else
+#endif
+        free(t->image);
+    memset(t, 0, sizeof(*t));
+}
+
+long keep_table_rank(const KeepTable *t, const int *take)
+{
+    // HandIter visits count vectors in reverse-lexicographic order, so a
+    // hand's rank is the number of vectors that hold more of some slot
+    // while agreeing with it on every slot before
+    long rank = 0;
+    int left = (int)t->hdr->hand_size;
+    for (uint32_t i = 0; i < t->hdr->ndistinct; ++i)
+    {
+        for (int v = take[i] + 1; v <= t->hdr->copies[i] && v <= left; ++v)
+            rank += (long)t->ways[i + 1][left - v];
+        left -= take[i];
+    }
+    return rank;
+}
+
+int keep_table_query(const KeepTable *t, const int *ids, int n, double *out)
+{
+    const KeepTableHeader *hdr = t->hdr;
+    int known[MAX_DISTINCT] = {0};
+    for (int i = 0; i < n; ++i)
+    {
+        int slot = ids[i] >= 0 && ids[i] < MAX_CARD_IDS ? t->slot_of[ids[i]] : -1;
+        if (slot < 0 || ++known[slot] > hdr->copies[slot])
+            return -1;
+    }
+    if (n > (int)hdr->hand_size)
+        return -1;
+    for (uint32_t turn = 0; turn < hdr->max_turns; ++turn)
+        out[turn] = 0.0;
+
+    // the rest of the hand is a random draw from the cards not known
+    uint8_t rest[MAX_DISTINCT];
+    for (uint32_t i = 0; i < hdr->ndistinct; ++i)
+        rest[i] = (uint8_t)(hdr->copies[i] - known[i]);
+    HandIter it;
+    hand_iter_init_counts(&it, rest, (int)hdr->ndistinct, (int)hdr->hand_size - n);
+    int full = n == (int)hdr->hand_size;
+    while (full || hand_iter_next(&it))
+    {
+        int take[MAX_DISTINCT];
+        memcpy(take, known, sizeof(take));
+        for (int j = 0; j < it.ndistinct; ++j)
+            take[it.ids[j]] += it.take[j];
+        double w = full ? 1.0 : hand_iter_weight(&it);
+        const float *e = &t->entries[(size_t)keep_table_rank(t, take) * hdr->max_turns];
+        for (uint32_t turn = 0; turn < hdr->max_turns; ++turn)
+            out[turn] += w * e[turn];
+        if (full)
+            break;
+    }
+    return 0;
+}
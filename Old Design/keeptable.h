@@ -0,0 +1,69 @@
+#ifndef KEEPTABLE_H
+#define KEEPTABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hands.h"
+
+// Precomputed keep table: P(win by turn t) for every opening-hand multiset
+// of one decklist, solved once by --build-table and then mapped read-only.
+//
+// A hand is its count vector take[] over the deck's distinct cards, and the
+// table is indexed by the vector's rank in HandIter order, so an entry is
+// found by arithmetic rather than search. The file is a header followed by
+// float[nhands][max_turns].
+
+#define KEEP_TABLE_MAGIC "SDKT"
+#define KEEP_TABLE_VERSION 1
+
+// most turns a table may hold; keep_table_query's out[] needs this many
+#define KEEP_TABLE_MAX_TURNS 64
+
+typedef struct KeepTableHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t hand_size;
+    uint32_t max_turns;
+    uint32_t ndistinct;
+    uint32_t nhands;
+    uint32_t entries_off;        // float[nhands][max_turns]
+    uint32_t size;               // total file size in bytes
+    uint8_t ids[MAX_DISTINCT];   // card id of each distinct slot (ascending)
+    uint8_t copies[MAX_DISTINCT]; // copies of that card in the deck
+} KeepTableHeader;
+
+typedef struct KeepTable
+{
+    const KeepTableHeader *hdr;
+    const float *entries;
+    void *image;
+    size_t size;
+    int mapped;
+    int slot_of[MAX_CARD_IDS]; // card id -> distinct slot, -1 if not in the deck
+    // ways[i][r]: count vectors of slots i.. that hold exactly r cards
+    double ways[MAX_DISTINCT + 1][MAX_HAND + 1];
+} KeepTable;
+
+// Write a table for the hands of `shape` (a HandIter after init), with
+// probs[h * max_turns + t] = P(win by turn t + 1) of the h-th hand in
+// enumeration order. Returns 0 on success, -1 on error.
+int keep_table_write(const char *path, const HandIter *shape, int max_turns, const float *probs);
+
+// Map a table written by keep_table_write. Returns 0 on success, -1 if the
+// file is missing or malformed (including max_turns above
+// KEEP_TABLE_MAX_TURNS).
+int keep_table_open(KeepTable *t, const char *path);
+void keep_table_close(KeepTable *t);
+
+// Index of count vector take[] (one entry per distinct slot) in the table.
+long keep_table_rank(const KeepTable *t, const int *take);
+
+// P(win by turn 1..max_turns) into out[] (room for hdr->max_turns, at most
+// KEEP_TABLE_MAX_TURNS) for an opening hand that contains
+// the n cards in ids[]. A full hand is one lookup; fewer cards average the
+// hands that contain them, weighted by how likely the rest of the hand is.
+// Returns 0, or -1 if the cards cannot all be in one hand of this deck.
+int keep_table_query(const KeepTable *t, const int *ids, int n, double *out);
+
+#endif // KEEPTABLE_H
@@ -5,9 +5,17 @@
 #include "card.h"
 #include "game.h"
 #include "deck.h"
+#include "pool.h"
+#include "hands.h"
+#include "ttable.h"
+#include "keeptable.h"
+#include "results.h"
+#include "checkpoint.h"
+#include "metrics.h"
 
-#include <pthread.h>
 #include <time.h>
+#include <signal.h>
+#include <pthread.h>
 #include <stdatomic.h>
 
 // forward from cards_repo
@@ -15,300 +23,776 @@ const Card *get_sample_card_pool(int *out_size);
 void create_sample_deck(int *deck_out, int deck_n);
 const int opponent_life = 10;
 
-int main(int argc, char **argv)
+enum
 {
-    enum
-    {
-        DECK_SIZE = 39
-    };
-    int deck[DECK_SIZE];
+    SAMPLE_DECK_SIZE = 39,
+    MAX_DECK = 60
+};
 
-    // card pool
-    int pool_size = 0;
-    const Card *pool = get_sample_card_pool(&pool_size);
+typedef struct
+{
+    int ids[MAX_HAND];
+    int n;
+    double weight; // probability of being dealt this multiset
+    int index;     // position of the hand in enumeration order
+} HandTask;
 
-    create_sample_deck(deck, DECK_SIZE);
-    shuffle_deck(deck, DECK_SIZE);
+// state shared by every hand task of an exhaustive run (read-only while
+// the pool is running, apart from the atomic counters)
+static struct
+{
+    const Card *pool;
+    int pool_size;
+    int deck[MAX_DECK];
+    int deck_size;
+    int max_turns;
+    atomic_int tasks_total;
+    atomic_int reused; // hands taken from --incremental's cache
+    atomic_int wins;
+    double *hand_prob; // P(win) per hand, in enumeration order
+    float *turn_prob;  // with --build-table: P(win by turn t + 1) at [hand * max_turns + t]
+    SolverScratch *scratch; // per-worker solver memory, reused across hands
+    ResultWriter *results;  // with --save: per-hand records; the producer writes as worker nworkers
+    int nhands;
+    atomic_uchar *done;     // per hand: set (release) once its results above are stored
+} run;
 
-    int hand_ids[MAX_HAND];
-    int drawn = draw_hand_from_deck(deck, DECK_SIZE, hand_ids, MAX_HAND);
-    if (drawn < MAX_HAND)
+// per-hand worker task: expects a malloc'd HandTask*
+static void solve_hand_task(void *arg, int worker_id)
+{
+    HandTask *task = (HandTask *)arg;
+    const Card *pool = run.pool;
+
+    GameState s;
+    memset(&s, 0, sizeof(s));
+    s.turn = 1;
+    // initialize life totals (same as non-exhaustive run)
+    s.opponent_life = opponent_life;
+    s.player_life = 20;
+    s.land_played_this_turn = 0;
+    s.hand_count = task->n;
+    for (int i = 0; i < task->n; ++i)
     {
-        printf("Not enough cards to draw a full hand (need %d)\n", MAX_HAND);
-        return 1;
+        s.hand_ids[i] = task->ids[i];
+        s.hand_used[i] = 0;
     }
+    s.card_pool = pool;
+    s.card_pool_size = run.pool_size;
 
-    GameState start;
-    memset(&start, 0, sizeof(start));
-    start.turn = 1;
-    // per-color mana/permanents are zero-initialized by memset
-    start.opponent_life = opponent_life; // example target
-    start.player_life = 20;
-    start.hand_count = MAX_HAND;
-    for (int i = 0; i < MAX_HAND; ++i)
+    // the library is the deck minus one copy of each card in the hand
+    int counts[MAX_CARD_IDS] = {0};
+    for (int i = 0; i < run.deck_size; ++i)
+        counts[run.deck[i]]++;
+    for (int h = 0; h < task->n; ++h)
+        counts[task->ids[h]]--;
+    for (int id = 0; id < MAX_CARD_IDS; ++id)
+        for (int c = 0; c < counts[id]; ++c)
+            library_add(&s, id);
+
+    // Compute exact win probability for this starting hand (branching over
+    // all possible draws). This may be expensive but is exact up to
+    // max_turns.
+    const SolverMetrics *m = &run.scratch[worker_id].metrics;
+    uint64_t nodes0 = metric_get(&m->nodes);
+    struct timespec t0, t1;
+    timespec_get(&t0, TIME_UTC);
+    double p = solve_hand_probability_with(&run.scratch[worker_id], &s, run.max_turns, NULL);
+    float *row = NULL;
+    if (run.turn_prob)
     {
-        start.hand_ids[i] = hand_ids[i];
-        start.hand_used[i] = 0;
+        row = &run.turn_prob[(size_t)task->index * run.max_turns];
+        for (int t = 1; t < run.max_turns; ++t)
+            row[t - 1] = (float)solve_hand_probability_with(&run.scratch[worker_id], &s, t, NULL);
+        row[run.max_turns - 1] = (float)p;
     }
-    start.card_pool = pool;
-    start.card_pool_size = pool_size;
-
-    // initialize library for the start state: remaining deck after drawing opening hand
-    if (DECK_SIZE - drawn > 0)
+    timespec_get(&t1, TIME_UTC);
+    if (run.results)
     {
-        start.library_size = DECK_SIZE - drawn;
-        start.library = malloc(sizeof(int) * start.library_size);
-        for (int i = 0; i < start.library_size; ++i)
-            start.library[i] = deck[drawn + i];
+        ResultRecord rec = {
+            .hand_key = hand_key(task->ids, task->n),
+            .weight = task->weight,
+            .nodes = metric_get(&m->nodes) - nodes0,
+            .seconds = (float)((double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) * 1e-9),
+        };
+        float last = (float)p;
+        results_add(run.results, worker_id, &rec, row ? row : &last);
     }
-    else
+
+    run.hand_prob[task->index] = p;
+    if (p > 0.0)
+        atomic_fetch_add(&run.wins, 1);
+    atomic_fetch_add(&run.tasks_total, 1);
+    atomic_store_explicit(&run.done[task->index], 1, memory_order_release);
+    free(task);
+}
+
+// Shortest-kill mode: the hand is the first MAX_HAND cards of the shuffled
+// deck and the rest of the deck, in order, is the known library.
+static int run_kill_search(const int *deck, const int *hand_ids, int max_turns, int nlines)
+{
+    GameState s;
+    memset(&s, 0, sizeof(s));
+    s.turn = 1;
+    s.opponent_life = opponent_life;
+    s.player_life = 20;
+    s.hand_count = MAX_HAND;
+    for (int i = 0; i < MAX_HAND; ++i)
+        s.hand_ids[i] = hand_ids[i];
+    s.card_pool = run.pool;
+    s.card_pool_size = run.pool_size;
+    // the next LIBRARY_TOP_MAX cards become the known prefix, in draw order
+    for (int i = MAX_HAND; i < run.deck_size; ++i)
+        library_add(&s, deck[i]);
+    for (int i = MAX_HAND; i < run.deck_size && i - MAX_HAND < LIBRARY_TOP_MAX; ++i)
+        library_put_top(&s, deck[i]);
+
+    printf("Hand:");
+    for (int i = 0; i < MAX_HAND; ++i)
+        printf(" %s", run.pool[hand_ids[i]].name);
+    printf("\n");
+
+    if (nlines < 1)
+        nlines = 1;
+    KillResult *res = malloc(sizeof(KillResult) * nlines);
+    if (!res)
+        return 1;
+    SolverScratch scratch;
+    solver_scratch_init(&scratch);
+    int found = solve_top_kills(&scratch, &s, max_turns, res, nlines);
+    // lines are only turned into text here, after the search
+    char line[MAX_SEQ_LEN * 4];
+    for (int i = 0; i < found; ++i)
     {
-        start.library = NULL;
-        start.library_size = 0;
+        format_kill_line(&s, &res[i], line, (int)sizeof(line));
+        printf("[WIN #%d] turn %d, %d actions\nSequence:\n%s", i + 1, res[i].kill_turn, res[i].actions, line);
     }
+    if (found == 0)
+        printf("No kill within %d turns.\n", max_turns);
+    printf("Searched %lld nodes in %.3f s\n", res[0].nodes, res[0].seconds);
+    solver_scratch_free(&scratch);
+    free(res);
+    return 0;
+}
 
-    // printf("Drawn hand:\n");
-    // for (int i = 0; i < start.hand_count; ++i)
-    // {
-    //     printf("  %d: %s\n", i + 1, pool[start.hand_ids[i]].name);
-    // }
+// Per-hand results of an earlier run, for --incremental, read from a
+// results file written by --save
+typedef struct
+{
+    int max_turns;
+    int deck_counts[MAX_CARD_IDS];
+    StateTable probs; // hand key -> P(win)
+} ResultCache;
 
-    // If run with --exhaustive, test all possible hands (order doesn't matter)
+static int load_result_cache(ResultCache *rc, const char *path)
+{
+    ResultsFile rf;
+    if (results_read(&rf, path) != 0)
+        return -1;
+    memset(rc, 0, sizeof(*rc));
+    rc->max_turns = (int)rf.hdr.max_turns;
+    for (int id = 0; id < MAX_CARD_IDS; ++id)
+        rc->deck_counts[id] = rf.hdr.deck_counts[id];
+    st_init(&rc->probs, 1024);
+    for (long i = 0; i < rf.count; ++i)
+    {
+        int found = 0;
+        StateEntry *e = st_insert(&rc->probs, results_record(&rf, i)->hand_key, &found);
+        // the last probability is the one for the run's turn limit
+        if (e)
+            e->value = results_prob(&rf, i)[rf.hdr.nprob - 1];
+    }
+    results_free(&rf);
+    return 0;
+}
 
-    typedef struct
+// P(win) of the deck the cache was built from, weighting each cached hand
+// by its probability under that deck
+static double cached_deck_prob(const ResultCache *rc)
+{
+    double prob = 0.0;
+    HandIter it;
+    uint8_t counts[MAX_CARD_IDS];
+    for (int id = 0; id < MAX_CARD_IDS; ++id)
+        counts[id] = (uint8_t)rc->deck_counts[id];
+    hand_iter_init_counts(&it, counts, MAX_CARD_IDS, MAX_HAND);
+    while (hand_iter_next(&it))
     {
         int ids[MAX_HAND];
-        int n;
-    } HandTask;
+        int n = hand_iter_ids(&it, ids);
+        StateEntry *e = st_find(&rc->probs, hand_key(ids, n));
+        if (e)
+            prob += hand_iter_weight(&it) * e->value;
+    }
+    return prob;
+}
 
-    atomic_int tasks_total = 0;
-    atomic_int wins = 0;
+// Print a results file written by --save as CSV
+static int run_to_csv(const char *path)
+{
+    ResultsFile rf;
+    if (results_read(&rf, path) != 0)
+        return 1;
+    int rc = results_write_csv(&rf, stdout);
+    results_free(&rf);
+    return rc != 0;
+}
 
-    // per-hand thread function: expects a malloc'd HandTask*
-    void *per_hand_fn(void *arg)
+// Periodic checkpoints (--checkpoint): a thread snapshots the finished
+// hands every `interval` seconds, and on SIGINT/SIGTERM writes a last one
+// before exiting.
+static struct
+{
+    const char *path;
+    int interval;
+    Checkpoint snap;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cv;
+    int stop;
+} ckpt;
+
+static volatile sig_atomic_t interrupted;
+
+static void on_interrupt(int sig)
+{
+    interrupted = sig;
+}
+
+// snapshot every hand marked done and write the checkpoint. Counters are
+// recomputed from the snapshot so they match the hands it holds exactly.
+static int save_checkpoint(void)
+{
+    Checkpoint *ck = &ckpt.snap;
+    uint32_t nprob = ck->hdr.nprob;
+    ck->hdr.solved = 0;
+    ck->hdr.wins = 0;
+    for (int h = 0; h < run.nhands; ++h)
+    {
+        ck->done[h] = atomic_load_explicit(&run.done[h], memory_order_acquire);
+        if (!ck->done[h])
+            continue;
+        ck->prob[h] = run.hand_prob[h];
+        if (nprob)
+            memcpy(&ck->turn_prob[(size_t)h * nprob], &run.turn_prob[(size_t)h * nprob], sizeof(float) * nprob);
+        ck->hdr.solved++;
+        ck->hdr.wins += run.hand_prob[h] > 0.0;
+    }
+    return checkpoint_write(ck, ckpt.path);
+}
+
+static void *checkpoint_main(void *arg)
+{
+    (void)arg;
+    struct timespec next;
+    timespec_get(&next, TIME_UTC);
+    next.tv_sec += ckpt.interval;
+    pthread_mutex_lock(&ckpt.lock);
+    while (!ckpt.stop)
     {
-        HandTask *task = (HandTask *)arg;
-
-        GameState s;
-        memset(&s, 0, sizeof(s));
-        s.turn = 1;
-        // initialize life totals (same as non-exhaustive run)
-        s.opponent_life = opponent_life;
-        s.player_life = 20;
-        s.land_played_this_turn = 0;
-        s.hand_count = task->n;
-        for (int i = 0; i < task->n; ++i)
+        // wake every second to notice a signal
+        struct timespec wake;
+        timespec_get(&wake, TIME_UTC);
+        wake.tv_sec += 1;
+        pthread_cond_timedwait(&ckpt.cv, &ckpt.lock, &wake);
+        if (ckpt.stop)
+            break;
+        struct timespec now;
+        timespec_get(&now, TIME_UTC);
+        if (!interrupted && now.tv_sec < next.tv_sec)
+            continue;
+        pthread_mutex_unlock(&ckpt.lock);
+        int rc = save_checkpoint();
+        if (interrupted)
         {
-            s.hand_ids[i] = task->ids[i];
-            s.hand_used[i] = 0;
+            fprintf(stderr, rc == 0 ? "interrupted; %u of %d hands saved to %s\n" : "interrupted; %u of %d hands lost\n",
+                    ckpt.snap.hdr.solved, run.nhands, ckpt.path);
+            _Exit(128 + interrupted);
         }
-        s.card_pool = pool;
-        s.card_pool_size = pool_size;
-
-        // build a per-hand library by copying the shuffled deck and removing
-        // one occurrence of each card present in the starting hand (task->ids)
-        int *tmp = malloc(sizeof(int) * DECK_SIZE);
-        int tmp_n = 0;
-        for (int i = 0; i < DECK_SIZE; ++i)
-            tmp[tmp_n++] = deck[i];
-        // remove one occurrence per hand card id
-        for (int h = 0; h < task->n; ++h)
+        pthread_mutex_lock(&ckpt.lock);
+        next = now;
+        next.tv_sec += ckpt.interval;
+    }
+    pthread_mutex_unlock(&ckpt.lock);
+    return NULL;
+}
+
+// Live metrics (--metrics SEC): a thread merges the workers' solver
+// counters every `interval` seconds and prints a line to stderr.
+static struct
+{
+    int interval;
+    struct timespec start;
+    int nworkers;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cv;
+    int stop;
+} monitor;
+
+static MetricsSnapshot take_metrics(void)
+{
+    MetricsSnapshot s;
+    memset(&s, 0, sizeof(s));
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    s.seconds = (double)(now.tv_sec - monitor.start.tv_sec) + (double)(now.tv_nsec - monitor.start.tv_nsec) * 1e-9;
+    for (int i = 0; i < monitor.nworkers; ++i)
+        metrics_accumulate(&s, &run.scratch[i].metrics);
+    s.hands_done = atomic_load(&run.tasks_total) + atomic_load(&run.reused);
+    s.hands_total = run.nhands;
+    metrics_read_rss(&s);
+    return s;
+}
+
+static void *monitor_main(void *arg)
+{
+    (void)arg;
+    MetricsSnapshot prev = take_metrics();
+    pthread_mutex_lock(&monitor.lock);
+    while (!monitor.stop)
+    {
+        struct timespec wake;
+        timespec_get(&wake, TIME_UTC);
+        wake.tv_sec += monitor.interval;
+        while (!monitor.stop && pthread_cond_timedwait(&monitor.cv, &monitor.lock, &wake) == 0)
+            ;
+        if (monitor.stop)
+            break;
+        MetricsSnapshot cur = take_metrics();
+        metrics_print(stderr, &cur, &prev);
+        prev = cur;
+    }
+    pthread_mutex_unlock(&monitor.lock);
+    return NULL;
+}
+
+// Keep-table query: P(win by each turn) for an opening hand holding the
+// named cards, from a table written by --build-table
+static int run_table_query(const char *path, char **names, int nnames)
+{
+    KeepTable table;
+    if (keep_table_open(&table, path) != 0)
+        return 1;
+    int ids[MAX_HAND];
+    int n = 0;
+    for (int i = 0; i < nnames; ++i)
+    {
+        int id = -1;
+        for (int c = 0; c < run.pool_size; ++c)
         {
-            int want = task->ids[h];
-            int found = 0;
-            for (int j = 0; j < tmp_n; ++j)
-            {
-                if (tmp[j] == want)
-                {
-                    // remove by shifting
-                    for (int k2 = j; k2 + 1 < tmp_n; ++k2)
-                        tmp[k2] = tmp[k2 + 1];
-                    tmp_n--;
-                    found = 1;
-                    break;
-                }
-            }
-            (void)found; // it's okay if not found (shouldn't happen)
+            if (run.pool[c].name && strcmp(run.pool[c].name, names[i]) == 0)
+                id = c;
         }
-        if (tmp_n > 0)
+        if (id < 0 || n >= MAX_HAND)
         {
-            s.library = malloc(sizeof(int) * tmp_n);
-            s.library_size = tmp_n;
-            for (int i = 0; i < tmp_n; ++i)
-                s.library[i] = tmp[i];
+            fprintf(stderr, id < 0 ? "unknown card \"%s\"\n" : "too many cards: %s\n", names[i]);
+            keep_table_close(&table);
+            return 1;
         }
-        else
+        ids[n++] = id;
+    }
+    double prob[KEEP_TABLE_MAX_TURNS];
+    struct timespec t0, t1;
+    timespec_get(&t0, TIME_UTC);
+    int rc = keep_table_query(&table, ids, n, prob);
+    timespec_get(&t1, TIME_UTC);
+    if (rc != 0)
+    {
+        fprintf(stderr, "those cards cannot all be in one opening hand of the table's deck\n");
+        keep_table_close(&table);
+        return 1;
+    }
+    printf("%d of %u cards known:\n", n, table.hdr->hand_size);
+    for (uint32_t t = 0; t < table.hdr->max_turns; ++t)
+        printf("  P(win by turn %u) = %.8f\n", t + 1, prob[t]);
+    printf("Answered in %.1f us\n", (double)(t1.tv_sec - t0.tv_sec) * 1e6 + (double)(t1.tv_nsec - t0.tv_nsec) * 1e-3);
+    keep_table_close(&table);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    // optional: --threads N (default: one worker per online core)
+    //           --kill T     find the fastest kill within T turns for the
+    //                        sample hand against the shuffled library
+    //           --lines K    with --kill, print the K best distinct lines
+    //           --deck FILE  decklist of "<count> <name>" lines instead of
+    //                        the built-in sample deck
+    //           --turns T    turn limit of the exhaustive run (default 3)
+    //           --save FILE  write per-hand results of the run to FILE
+    //                        (binary, see results.h)
+    //           --to-csv FILE
+    //                        print a results file from --save as CSV
+    //           --incremental FILE
+    //                        reuse the per-hand results in FILE (from --save)
+    //                        and re-solve only hands with a changed card
+    //           --build-table FILE
+    //                        also solve every hand for each turn up to T and
+    //                        write the keep table (see keeptable.h) to FILE
+    //           --checkpoint FILE
+    //                        save the run's progress to FILE every
+    //                        --checkpoint-every SEC seconds (default 60),
+    //                        and on SIGINT/SIGTERM
+    //           --resume     with --checkpoint, skip the hands already
+    //                        finished in FILE (starts fresh if it is missing)
+    //           --metrics SEC
+    //                        print solver counters to stderr every SEC
+    //                        seconds (default 10, 0 = off)
+    //           --metrics-json FILE
+    //                        write the final counters to FILE as JSON
+    //           --query TABLE CARD...
+    //                        P(win by each turn) for a hand holding the named
+    //                        cards (all 7, or fewer to average the rest)
+    int nthreads = 0;
+    int kill_turns = 0;
+    int kill_lines = 1;
+    const char *deck_path = NULL;
+    const char *save_path = NULL;
+    const char *cache_path = NULL;
+    const char *table_path = NULL;
+    const char *query_path = NULL;
+    const char *checkpoint_path = NULL;
+    int checkpoint_every = 60;
+    int resume = 0;
+    int metrics_every = 10;
+    const char *metrics_path = NULL;
+    int query_first = argc;
+    run.max_turns = 3;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            nthreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--kill") == 0 && i + 1 < argc)
+            kill_turns = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--lines") == 0 && i + 1 < argc)
+            kill_lines = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--deck") == 0 && i + 1 < argc)
+            deck_path = argv[++i];
+        else if (strcmp(argv[i], "--turns") == 0 && i + 1 < argc)
+            run.max_turns = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc)
+            save_path = argv[++i];
+        else if (strcmp(argv[i], "--to-csv") == 0 && i + 1 < argc)
+            return run_to_csv(argv[i + 1]);
+        else if (strcmp(argv[i], "--incremental") == 0 && i + 1 < argc)
+            cache_path = argv[++i];
+        else if (strcmp(argv[i], "--build-table") == 0 && i + 1 < argc)
+            table_path = argv[++i];
+        else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc)
+            checkpoint_path = argv[++i];
+        else if (strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc)
+            checkpoint_every = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--resume") == 0)
+            resume = 1;
+        else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+            metrics_every = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--metrics-json") == 0 && i + 1 < argc)
+            metrics_path = argv[++i];
+        else if (strcmp(argv[i], "--query") == 0 && i + 1 < argc)
         {
-            s.library = NULL;
-            s.library_size = 0;
+            query_path = argv[++i];
+            query_first = i + 1;
+            break;
         }
-        free(tmp);
-
-        // Compute exact win probability for this starting hand (branching over
-        // all possible draws). This may be expensive but is exact up to
-        // max_turns.
-        double p = solve_hand_probability(&s, 3);
-        // build single output string to avoid interleaved prints from multiple threads
-        char outbuf[2048];
-        int off = 0;
+    }
+
+    if (table_path && cache_path)
+    {
+        // reused hands would have no per-turn results
+        fprintf(stderr, "--build-table solves every hand; it cannot be combined with --incremental\n");
+        return 1;
+    }
+
+    if (resume && !checkpoint_path)
+    {
+        fprintf(stderr, "--resume needs --checkpoint FILE\n");
+        return 1;
+    }
+    if (checkpoint_every < 1)
+        checkpoint_every = 1;
+
+    int *deck = run.deck;
+
+    // card pool
+    int pool_size = 0;
+    const Card *pool = get_sample_card_pool(&pool_size);
+    run.pool = pool;
+    run.pool_size = pool_size;
+    if (query_path)
+        return run_table_query(query_path, &argv[query_first], argc - query_first);
+
+    if (deck_path)
+    {
+        run.deck_size = load_deck(deck_path, pool, pool_size, deck, MAX_DECK);
+        if (run.deck_size < 0)
+            return 1;
+    }
+    else
+    {
+        run.deck_size = SAMPLE_DECK_SIZE;
+        create_sample_deck(deck, run.deck_size);
+    }
+    shuffle_deck(deck, run.deck_size);
+
+    int hand_ids[MAX_HAND];
+    int drawn = draw_hand_from_deck(deck, run.deck_size, hand_ids, MAX_HAND);
+    if (drawn < MAX_HAND)
+    {
+        printf("Not enough cards to draw a full hand (need %d)\n", MAX_HAND);
+        return 1;
+    }
+
+    if (kill_turns > 0)
+        return run_kill_search(deck, hand_ids, kill_turns, kill_lines);
+
+    // printf("Drawn hand:\n");
+    // for (int i = 0; i < MAX_HAND; ++i)
+    // {
+    //     printf("  %d: %s\n", i + 1, pool[hand_ids[i]].name);
+    // }
+
+    // Incremental mode: hands without a card whose count changed keep their
+    // cached result; only their weights are recomputed for the new deck.
+    ResultCache cache;
+    int changed[MAX_CARD_IDS] = {0};
+    if (cache_path)
+    {
+        if (load_result_cache(&cache, cache_path) != 0)
+            return 1;
+        if (cache.max_turns != run.max_turns)
         {
-            int rem = (int)sizeof(outbuf) - off;
-            int r = snprintf(outbuf + off, rem, "Thread %lu hand: prob=%.6f", (unsigned long)pthread_self(), p);
-            if (r < 0)
-                r = 0;
-            if (r >= rem)
-                off = (int)sizeof(outbuf) - 1;
-            else
-                off += r;
+            fprintf(stderr, "%s was solved for %d turns, not %d\n", cache_path, cache.max_turns, run.max_turns);
+            return 1;
         }
-        for (int i = 0; i < task->n && off < (int)sizeof(outbuf) - 1; ++i)
+        int counts[MAX_CARD_IDS] = {0};
+        for (int i = 0; i < run.deck_size; ++i)
+            counts[deck[i]]++;
+        for (int id = 0; id < MAX_CARD_IDS; ++id)
+            changed[id] = counts[id] != cache.deck_counts[id];
+    }
+
+    // Exhaustive mode: test all possible hands (order doesn't matter) on a
+    // fixed-size work-stealing pool instead of one thread per hand.
+    atomic_init(&run.tasks_total, 0);
+    atomic_init(&run.reused, 0);
+    atomic_init(&run.wins, 0);
+    ThreadPool *workers = pool_create(nthreads);
+    if (!workers)
+    {
+        fprintf(stderr, "failed to start worker pool\n");
+        return 1;
+    }
+
+    int nworkers = pool_worker_count(workers);
+    run.scratch = malloc(sizeof(SolverScratch) * nworkers);
+    for (int i = 0; i < nworkers; ++i)
+        solver_scratch_init(&run.scratch[i]);
+
+    // producer: enumerate each distinct hand multiset once, with its exact
+    // hypergeometric weight, instead of all C(deck size, MAX_HAND) index
+    // combinations. Results are stored by enumeration index, so count the
+    // hands first.
+    HandIter it;
+    int nhands = 0;
+    if (hand_iter_init(&it, deck, run.deck_size, MAX_HAND) != 0)
+    {
+        fprintf(stderr, "the deck has more than %d distinct cards\n", MAX_DISTINCT);
+        return 1;
+    }
+    while (hand_iter_next(&it))
+        ++nhands;
+    run.nhands = nhands;
+    run.hand_prob = calloc((size_t)nhands, sizeof(double));
+    run.done = calloc((size_t)nhands, sizeof(atomic_uchar));
+    if (table_path)
+        run.turn_prob = calloc((size_t)nhands * run.max_turns, sizeof(float));
+
+    // Resume: hands finished before the checkpoint keep their results and
+    // count toward the totals once; only the rest are queued.
+    Checkpoint restored;
+    memset(&restored, 0, sizeof(restored));
+    if (checkpoint_path)
+    {
+        int nprob = table_path ? run.max_turns : 0;
+        int rc = resume ? checkpoint_read(&restored, checkpoint_path) : 1;
+        if (rc < 0)
+            return 1;
+        if (rc == 1 && resume)
+            fprintf(stderr, "no checkpoint at %s; starting from the beginning\n", checkpoint_path);
+        if (rc == 0)
         {
-            const char *nm = pool[task->ids[i]].name ? pool[task->ids[i]].name : "(null)";
+            int counts[MAX_CARD_IDS] = {0};
+            for (int i = 0; i < run.deck_size; ++i)
+                counts[deck[i]]++;
+            int same_deck = 1;
+            for (int id = 0; id < MAX_CARD_IDS; ++id)
+                same_deck &= restored.hdr.deck_counts[id] == counts[id];
+            if (!same_deck || restored.hdr.max_turns != (uint32_t)run.max_turns ||
+                restored.hdr.nhands != (uint32_t)nhands || restored.hdr.nprob != (uint32_t)nprob)
             {
-                int rem = (int)sizeof(outbuf) - off;
-                int r = snprintf(outbuf + off, rem, " %s", nm);
-                if (r < 0)
-                    r = 0;
-                if (r >= rem)
-                {
-                    off = (int)sizeof(outbuf) - 1;
-                    break;
-                }
-                else
-                    off += r;
+                fprintf(stderr, "%s is a checkpoint of a different run (deck, --turns or --build-table)\n",
+                        checkpoint_path);
+                return 1;
             }
+            atomic_store(&run.tasks_total, (int)restored.hdr.solved);
+            atomic_store(&run.wins, (int)restored.hdr.wins);
+            fprintf(stderr, "resuming: %u of %d hands already solved\n", restored.hdr.solved, nhands);
         }
+        if (checkpoint_alloc(&ckpt.snap, run.max_turns, nhands, nprob, deck, run.deck_size) != 0)
         {
-            int rem = (int)sizeof(outbuf) - off;
-            int r = snprintf(outbuf + off, rem, "\n");
-            if (r > 0 && r < rem)
-                off += r;
+            fprintf(stderr, "out of memory\n");
+            return 1;
         }
-        printf("%s", outbuf);
-
-        if (p > 0.0)
-            atomic_fetch_add(&wins, 1);
-        atomic_fetch_add(&tasks_total, 1);
-        if (s.library)
-            free(s.library);
-        free(task);
-        return NULL;
+    }
+    ResultWriter results;
+    if (save_path)
+    {
+        // one buffer per worker plus one for the producer's reused hands
+        int nprob = table_path ? run.max_turns : 1;
+        if (results_open(&results, save_path, run.max_turns, nprob, deck, run.deck_size, nworkers + 1) != 0)
+            return 1;
+        run.results = &results;
     }
 
-    // producer: generate combinations (deck indices) C(DECK_SIZE, MAX_HAND)
-    int n = DECK_SIZE;
-    int k = MAX_HAND;
-    if (k > n)
-        k = n;
-    int *comb = malloc(sizeof(int) * k);
-    for (int i = 0; i < k; ++i)
-        comb[i] = i;
-
-    // dynamic arrays to hold thread handles
-    int cap = 128;
-    pthread_t *threads = malloc(sizeof(pthread_t) * cap);
-    int tcount = 0;
-
-    // deduplication storage: store sorted card-id vectors of unique hands
-    int unique_cap = 0;
-    int unique_count = 0;
-    int *unique_store = NULL; // flattened array of unique hands (unique_cap * k)
-
-    // iterate combinations and spawn a thread per hand
-    for (;;)
+    if (checkpoint_path)
     {
-        HandTask *t = malloc(sizeof(HandTask));
-        t->n = k;
-        for (int i = 0; i < k; ++i)
-            t->ids[i] = deck[comb[i]]; // map deck index -> card id
-
-        // build sorted representation of this hand for deduplication
-        int ids_sorted[MAX_HAND];
-        for (int i = 0; i < k; ++i)
-            ids_sorted[i] = t->ids[i];
-        // simple insertion sort (k <= MAX_HAND small)
-        for (int ii = 1; ii < k; ++ii)
+        ckpt.path = checkpoint_path;
+        ckpt.interval = checkpoint_every;
+        pthread_mutex_init(&ckpt.lock, NULL);
+        pthread_cond_init(&ckpt.cv, NULL);
+        signal(SIGINT, on_interrupt);
+        signal(SIGTERM, on_interrupt);
+        if (pthread_create(&ckpt.thread, NULL, checkpoint_main, NULL) != 0)
         {
-            int key = ids_sorted[ii];
-            int jj = ii - 1;
-            while (jj >= 0 && ids_sorted[jj] > key)
-            {
-                ids_sorted[jj + 1] = ids_sorted[jj];
-                jj--;
-            }
-            ids_sorted[jj + 1] = key;
+            fprintf(stderr, "failed to start checkpoint thread\n");
+            return 1;
         }
+    }
 
-        // check if this sorted vector already exists
-        int duplicate = 0;
-        for (int u = 0; u < unique_count; ++u)
+    timespec_get(&monitor.start, TIME_UTC);
+    monitor.nworkers = nworkers;
+    monitor.interval = metrics_every;
+    if (metrics_every > 0)
+    {
+        pthread_mutex_init(&monitor.lock, NULL);
+        pthread_cond_init(&monitor.cv, NULL);
+        if (pthread_create(&monitor.thread, NULL, monitor_main, NULL) != 0)
+            monitor.interval = 0;
+    }
+
+    hand_iter_init(&it, deck, run.deck_size, MAX_HAND);
+    for (int h = 0; hand_iter_next(&it); ++h)
+    {
+        HandTask *t = malloc(sizeof(HandTask));
+        t->n = hand_iter_ids(&it, t->ids);
+        t->weight = hand_iter_weight(&it);
+        t->index = h;
+        if (restored.done && restored.done[h])
         {
-            int *uvec = &unique_store[u * k];
-            int same = 1;
-            for (int x = 0; x < k; ++x)
+            run.hand_prob[h] = restored.prob[h];
+            if (run.turn_prob)
+                memcpy(&run.turn_prob[(size_t)h * run.max_turns], &restored.turn_prob[(size_t)h * run.max_turns],
+                       sizeof(float) * run.max_turns);
+            atomic_store_explicit(&run.done[h], 1, memory_order_relaxed);
+            if (run.results)
             {
-                if (uvec[x] != ids_sorted[x])
-                {
-                    same = 0;
-                    break;
-                }
-            }
-            if (same)
-            {
-                duplicate = 1;
-                break;
+                // the solver statistics of earlier runs are not kept
+                ResultRecord rec = {.hand_key = hand_key(t->ids, t->n), .weight = t->weight};
+                float p = (float)restored.prob[h];
+                results_add(run.results, nworkers, &rec,
+                            run.turn_prob ? &run.turn_prob[(size_t)h * run.max_turns] : &p);
             }
+            free(t);
+            continue;
         }
-        if (duplicate)
-        {
-            free(t); // skip duplicate hand
-        }
-        else
+        if (cache_path)
         {
-            // store the unique vector
-            if (unique_count >= unique_cap)
+            int dirty = 0;
+            for (int i = 0; i < t->n; ++i)
+                dirty |= changed[t->ids[i]];
+            StateEntry *e = dirty ? NULL : st_find(&cache.probs, hand_key(t->ids, t->n));
+            if (e)
             {
-                unique_cap = unique_cap ? unique_cap * 2 : 64;
-                unique_store = realloc(unique_store, sizeof(int) * unique_cap * k);
-            }
-            memcpy(&unique_store[unique_count * k], ids_sorted, sizeof(int) * k);
-            unique_count++;
-
-            if (tcount >= cap)
-            {
-                cap *= 2;
-                threads = realloc(threads, sizeof(pthread_t) * cap);
-            }
-            if (pthread_create(&threads[tcount], NULL, per_hand_fn, t) != 0)
-            {
-                perror("pthread_create");
+                run.hand_prob[h] = e->value;
+                if (run.results)
+                {
+                    ResultRecord rec = {.hand_key = e->key, .weight = t->weight};
+                    float p = (float)e->value;
+                    results_add(run.results, nworkers, &rec, &p);
+                }
+                atomic_fetch_add(&run.reused, 1);
                 free(t);
-            }
-            else
-            {
-                tcount++;
+                continue;
             }
         }
+        pool_submit(workers, solve_hand_task, t);
+    }
 
-        // next combination
-        int i = k - 1;
-        while (i >= 0 && comb[i] == i + n - k)
-            i--;
-        if (i < 0)
-            break;
-        comb[i]++;
-        for (int j = i + 1; j < k; ++j)
-            comb[j] = comb[j - 1] + 1;
+    // wait for the queued hands to drain
+    pool_finish(workers);
+
+    if (monitor.interval > 0)
+    {
+        pthread_mutex_lock(&monitor.lock);
+        monitor.stop = 1;
+        pthread_cond_signal(&monitor.cv);
+        pthread_mutex_unlock(&monitor.lock);
+        pthread_join(monitor.thread, NULL);
+    }
+    MetricsSnapshot final_metrics = take_metrics();
+    if (monitor.interval > 0)
+        metrics_print(stderr, &final_metrics, NULL);
+    if (metrics_path && metrics_write_json(metrics_path, &final_metrics) != 0)
+        return 1;
+
+    if (checkpoint_path)
+    {
+        pthread_mutex_lock(&ckpt.lock);
+        ckpt.stop = 1;
+        pthread_cond_signal(&ckpt.cv);
+        pthread_mutex_unlock(&ckpt.lock);
+        pthread_join(ckpt.thread, NULL);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        // a finished run's checkpoint resumes to just the summary
+        if (save_checkpoint() != 0)
+            return 1;
+        checkpoint_free(&ckpt.snap);
+        checkpoint_free(&restored);
     }
 
-    // join all threads
-    for (int i = 0; i < tcount; ++i)
-        pthread_join(threads[i], NULL);
+    // deck-level probability is the weighted sum over hand multisets
+    double deck_prob = 0.0;
+    hand_iter_init(&it, deck, run.deck_size, MAX_HAND);
+    for (int h = 0; hand_iter_next(&it); ++h)
+        deck_prob += hand_iter_weight(&it) * run.hand_prob[h];
 
-    printf("Exhaustive finished: tested %d hands, %d wins.\n", atomic_load(&tasks_total), atomic_load(&wins));
+    printf("Exhaustive finished: tested %d hands (%.0f combinations), %d wins.\n", atomic_load(&run.tasks_total), it.total_combos, atomic_load(&run.wins));
+    printf("Deck win probability: %.8f\n", deck_prob);
+    if (cache_path)
+    {
+        double old_prob = cached_deck_prob(&cache);
+        printf("Previous deck win probability: %.8f (delta %+.8f)\n", old_prob, deck_prob - old_prob);
+        // a reused hand's draws were solved against the old library, so its
+        // value is exact only for the cards it holds, not for what it draws
+        printf("Reused %d of %d hands from %s; their draw odds reflect the previous deck.\n", atomic_load(&run.reused), nhands, cache_path);
+        st_free(&cache.probs);
+    }
+    if (run.results && results_close(run.results) != 0)
+        return 1;
+    if (table_path)
+    {
+        hand_iter_init(&it, deck, run.deck_size, MAX_HAND);
+        if (keep_table_write(table_path, &it, run.max_turns, run.turn_prob) != 0)
+            return 1;
+    }
 
-    free(threads);
-    free(comb);
+    for (int i = 0; i < nworkers; ++i)
+        solver_scratch_free(&run.scratch[i]);
+    free(run.scratch);
+    free(run.hand_prob);
+    free(run.turn_prob);
+    free(run.done);
 
     return 0;
 }
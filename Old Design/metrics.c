@@ -0,0 +1,98 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "metrics.h"
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+void metrics_accumulate(MetricsSnapshot *s, const SolverMetrics *m)
+{
+    s->nodes += metric_get(&m->nodes);
+    s->chance_nodes += metric_get(&m->chance_nodes);
+    s->tt_hits += metric_get(&m->tt_hits);
+    s->tt_misses += metric_get(&m->tt_misses);
+    s->prunes += metric_get(&m->prunes);
+    uint64_t peak = metric_get(&m->peak_table);
+    if (peak > s->peak_table)
+        s->peak_table = peak;
+}
+
+void metrics_read_rss(MetricsSnapshot *s)
+{
+    s->rss_bytes = 0;
+    s->peak_rss_bytes = 0;
+#ifdef __linux__
+    // resident pages are the second field
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f)
+    {
+        long size, resident;
+        if (fscanf(f, "%ld %ld", &size, &resident) == 2)
+            s->rss_bytes = resident * sysconf(_SC_PAGESIZE);
+        fclose(f);
+    }
+#endif
+#ifndef _WIN32
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0)
+    {
+#ifdef __APPLE__
+        s->peak_rss_bytes = ru.ru_maxrss; // bytes on macOS
+#else
+        s->peak_rss_bytes = ru.ru_maxrss * 1024L; // kilobytes elsewhere
+#endif
+    }
+#endif
+}
+
+void metrics_print(FILE *out, const MetricsSnapshot *s, const MetricsSnapshot *prev)
+{
+    double dt = prev ? s->seconds - prev->seconds : s->seconds;
+    uint64_t dn = prev ? s->nodes - prev->nodes : s->nodes;
+    uint64_t lookups = s->tt_hits + s->tt_misses;
+    fprintf(out,
+            "[%.0fs] hands %ld/%ld (%ld left)  nodes %llu (%.0f/s)  chance %llu  tt hit %.1f%%  prunes %llu  "
+            "peak table %llu  rss %.1f MB\n",
+            s->seconds, s->hands_done, s->hands_total, s->hands_total - s->hands_done, (unsigned long long)s->nodes,
+            dt > 0.0 ? (double)dn / dt : 0.0, (unsigned long long)s->chance_nodes,
+            lookups ? 100.0 * (double)s->tt_hits / (double)lookups : 0.0, (unsigned long long)s->prunes,
+            (unsigned long long)s->peak_table, (double)s->rss_bytes / (1024.0 * 1024.0));
+}
+
+int metrics_write_json(const char *path, const MetricsSnapshot *s)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        fprintf(stderr, "cannot write metrics %s\n", path);
+        return -1;
+    }
+    fprintf(f,
+            "{\n"
+            "  \"seconds\": %.3f,\n"
+            "  \"hands_done\": %ld,\n"
+            "  \"hands_total\": %ld,\n"
+            "  \"nodes\": %llu,\n"
+            "  \"nodes_per_second\": %.1f,\n"
+            "  \"chance_nodes\": %llu,\n"
+            "  \"tt_hits\": %llu,\n"
+            "  \"tt_misses\": %llu,\n"
+            "  \"prunes\": %llu,\n"
+            "  \"peak_table_entries\": %llu,\n"
+            "  \"rss_bytes\": %ld,\n"
+            "  \"peak_rss_bytes\": %ld\n"
+            "}\n",
+            s->seconds, s->hands_done, s->hands_total, (unsigned long long)s->nodes,
+            s->seconds > 0.0 ? (double)s->nodes / s->seconds : 0.0, (unsigned long long)s->chance_nodes,
+            (unsigned long long)s->tt_hits, (unsigned long long)s->tt_misses, (unsigned long long)s->prunes,
+            (unsigned long long)s->peak_table, s->rss_bytes, s->peak_rss_bytes);
+    if (fclose(f) != 0)
+    {
+        fprintf(stderr, "error writing metrics %s\n", path);
+        return -1;
+    }
+    return 0;
+}
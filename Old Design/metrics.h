@@ -0,0 +1,67 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Solver counters. Each worker owns one SolverMetrics (in its
+// SolverScratch) and is the only thread that writes it, so a counter update
+// is a relaxed load and store rather than a locked add; readers sum the
+// per-worker blocks whenever they want a total. Each block starts on its
+// own cache line so workers never share one.
+typedef struct SolverMetrics
+{
+    _Alignas(64) _Atomic uint64_t nodes; // states expanded (transposition misses that were searched)
+    _Atomic uint64_t chance_nodes;       // draw events averaged over library cards
+    _Atomic uint64_t tt_hits;
+    _Atomic uint64_t tt_misses;
+    _Atomic uint64_t prunes;     // subtrees skipped: damage bound, or a line already wins for certain
+    _Atomic uint64_t peak_table; // most entries one solve's transposition table held
+} SolverMetrics;
+
+static inline void metric_add(_Atomic uint64_t *c, uint64_t n)
+{
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+static inline void metric_max(_Atomic uint64_t *c, uint64_t v)
+{
+    if (v > atomic_load_explicit(c, memory_order_relaxed))
+        atomic_store_explicit(c, v, memory_order_relaxed);
+}
+
+static inline uint64_t metric_get(const _Atomic uint64_t *c)
+{
+    return atomic_load_explicit((_Atomic uint64_t *)c, memory_order_relaxed);
+}
+
+// A merged view of a run at one moment
+typedef struct MetricsSnapshot
+{
+    double seconds; // since the run started
+    uint64_t nodes;
+    uint64_t chance_nodes;
+    uint64_t tt_hits;
+    uint64_t tt_misses;
+    uint64_t prunes;
+    uint64_t peak_table; // largest over workers
+    long hands_done;
+    long hands_total;
+    long rss_bytes;      // 0 where the platform does not report it
+    long peak_rss_bytes;
+} MetricsSnapshot;
+
+// add one worker's counters to s
+void metrics_accumulate(MetricsSnapshot *s, const SolverMetrics *m);
+
+// fill the RSS fields of s
+void metrics_read_rss(MetricsSnapshot *s);
+
+// one progress line; rates are measured since prev (NULL: since the start)
+void metrics_print(FILE *out, const MetricsSnapshot *s, const MetricsSnapshot *prev);
+
+// write s as a JSON object to path. Returns 0 on success.
+int metrics_write_json(const char *path, const MetricsSnapshot *s);
+
+#endif // METRICS_H
@@ -0,0 +1,91 @@
+#include "movegen.h"
+
+const MoveOrder default_move_order = {
+    .land_weight = 1000,
+    .role_weight = {
+        [ROLE_OTHER] = 500,
+        [ROLE_RITUAL] = 900,
+        [ROLE_ENGINE] = 800,
+        [ROLE_CANTRIP] = 700,
+        [ROLE_PAYOFF] = 300,
+    },
+    .tap_weight = 600,
+    .end_turn_weight = 0,
+    .history_weight = 10,
+    .history_cap = 50,
+};
+
+static int history_bonus(const MoveOrder *order, uint32_t count)
+{
+    if (count > (uint32_t)order->history_cap)
+        count = (uint32_t)order->history_cap;
+    return order->history_weight * (int)count;
+}
+
+int generate_moves(const GameState *s, const MoveOrder *order, const MoveHistory *hist,
+                   int allow_end_turn, Action *out)
+{
+    int score[MAX_MOVES];
+    int n = 0;
+
+    uint32_t playable = playable_mask(s);
+    for (int h = 0; playable; ++h, playable >>= 1)
+    {
+        if (!(playable & 1))
+            continue;
+        int cid = s->hand_ids[h];
+        const Card *c = &s->card_pool[cid];
+        out[n] = (Action){ACT_PLAY, (uint8_t)h};
+        score[n] = c->type == CARD_LAND ? order->land_weight : order->role_weight[c->role];
+        if (hist)
+            score[n] += history_bonus(order, hist->play[cid]);
+        ++n;
+    }
+    for (int color = 0; color < COLOR_COUNT; ++color)
+    {
+        if (s->battlefield_lands[color] <= s->battlefield_lands_tapped[color])
+            continue;
+        out[n] = (Action){ACT_TAP, (uint8_t)color};
+        score[n] = order->tap_weight + (hist ? history_bonus(order, hist->tap[color]) : 0);
+        ++n;
+    }
+    if (allow_end_turn)
+    {
+        out[n] = (Action){ACT_END_TURN, 0};
+        score[n] = order->end_turn_weight + (hist ? history_bonus(order, hist->end_turn) : 0);
+        ++n;
+    }
+
+    // stable insertion sort, highest score first; n is at most MAX_MOVES
+    for (int i = 1; i < n; ++i)
+    {
+        Action a = out[i];
+        int sc = score[i];
+        int j = i;
+        while (j > 0 && score[j - 1] < sc)
+        {
+            out[j] = out[j - 1];
+            score[j] = score[j - 1];
+            --j;
+        }
+        out[j] = a;
+        score[j] = sc;
+    }
+    return n;
+}
+
+void history_record(MoveHistory *hist, const GameState *s, Action m)
+{
+    switch (m.type)
+    {
+    case ACT_PLAY:
+        hist->play[s->hand_ids[m.arg]]++;
+        break;
+    case ACT_TAP:
+        hist->tap[m.arg]++;
+        break;
+    case ACT_END_TURN:
+        hist->end_turn++;
+        break;
+    }
+}
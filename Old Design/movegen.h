@@ -0,0 +1,46 @@
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include <stdint.h>
+#include "game.h"
+
+// most moves a state can have: every hand slot, a tap per color, end turn
+#define MAX_MOVES (MAX_HAND + COLOR_COUNT + 1)
+
+// Move-ordering heuristic. Each move scores a base weight for its kind,
+// plus history_weight per earlier win it took part in (capped at
+// history_cap), and moves are tried highest score first.
+typedef struct MoveOrder
+{
+    int land_weight;              // land drop
+    int role_weight[ROLE_COUNT];  // spells, by CardRole
+    int tap_weight;               // tapping a land for mana
+    int end_turn_weight;          // passing the turn
+    int history_weight;
+    int history_cap;
+} MoveOrder;
+
+// Default order: land drop first, then rituals, engines and cantrips,
+// payoffs last, ties broken by how often a move appeared in winning lines.
+extern const MoveOrder default_move_order;
+
+// How often each move appeared in a winning line found so far by a search.
+// Plays are counted by card id rather than hand slot so the history carries
+// over between positions.
+typedef struct MoveHistory
+{
+    uint32_t play[MAX_CARD_IDS];
+    uint32_t tap[COLOR_COUNT];
+    uint32_t end_turn;
+} MoveHistory;
+
+// Fill out[] (room for MAX_MOVES) with the legal moves of s in heuristic
+// order and return how many there are. End turn is included only when
+// allow_end_turn is set. hist may be NULL. Nothing is allocated.
+int generate_moves(const GameState *s, const MoveOrder *order, const MoveHistory *hist,
+                   int allow_end_turn, Action *out);
+
+// Credit move m, made from state s, with part of a win.
+void history_record(MoveHistory *hist, const GameState *s, Action m);
+
+#endif // MOVEGEN_H
@@ -0,0 +1,228 @@
+#define _POSIX_C_SOURCE 200809L
+#include "pool.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct PoolTask
+{
+    pool_task_fn fn;
+    void *arg;
+} PoolTask;
+
+// Bounded deque; the owner pushes/pops at the tail, thieves take from the head.
+typedef struct WorkDeque
+{
+    pthread_mutex_t lock;
+    int head;
+    int count;
+    PoolTask tasks[POOL_DEQUE_CAP];
+} WorkDeque;
+
+typedef struct WorkerArg
+{
+    ThreadPool *pool;
+    int id;
+} WorkerArg;
+
+struct ThreadPool
+{
+    int nworkers;
+    int ndeques;
+    pthread_t *threads;
+    WorkerArg *args;
+    WorkDeque *deques;
+    atomic_int queued; // tasks sitting in deques (not yet started)
+    pthread_mutex_t lock;
+    pthread_cond_t work_cv;  // signalled when work arrives or on shutdown
+    pthread_cond_t space_cv; // signalled when a task leaves a deque
+    int shutdown;
+    int next; // round-robin submit target (producer-only)
+};
+
+static int deque_push(WorkDeque *d, const PoolTask *t)
+{
+    int ok = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->count < POOL_DEQUE_CAP)
+    {
+        d->tasks[(d->head + d->count) % POOL_DEQUE_CAP] = *t;
+        d->count++;
+        ok = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+static int deque_pop_tail(WorkDeque *d, PoolTask *out)
+{
+    int ok = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->count > 0)
+    {
+        d->count--;
+        *out = d->tasks[(d->head + d->count) % POOL_DEQUE_CAP];
+        ok = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+static int deque_steal_head(WorkDeque *d, PoolTask *out)
+{
+    int ok = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->count > 0)
+    {
+        *out = d->tasks[d->head];
+        d->head = (d->head + 1) % POOL_DEQUE_CAP;
+        d->count--;
+        ok = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+static int take_task(ThreadPool *p, int id, PoolTask *out)
+{
+    if (deque_pop_tail(&p->deques[id], out))
+        return 1;
+    for (int k = 1; k < p->nworkers; ++k)
+    {
+        if (deque_steal_head(&p->deques[(id + k) % p->nworkers], out))
+            return 1;
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg)
+{
+    WorkerArg *wa = (WorkerArg *)arg;
+    ThreadPool *p = wa->pool;
+    for (;;)
+    {
+        PoolTask t;
+        if (take_task(p, wa->id, &t))
+        {
+            atomic_fetch_sub(&p->queued, 1);
+            pthread_mutex_lock(&p->lock);
+            pthread_cond_signal(&p->space_cv);
+            pthread_mutex_unlock(&p->lock);
+            t.fn(t.arg, wa->id);
+            continue;
+        }
+        pthread_mutex_lock(&p->lock);
+        while (atomic_load(&p->queued) == 0 && !p->shutdown)
+            pthread_cond_wait(&p->work_cv, &p->lock);
+        int done = atomic_load(&p->queued) == 0 && p->shutdown;
+        pthread_mutex_unlock(&p->lock);
+        if (done)
+            break;
+    }
+    return NULL;
+}
+
+int pool_default_workers(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+ThreadPool *pool_create(int nworkers)
+{
+    if (nworkers <= 0)
+        nworkers = pool_default_workers();
+    ThreadPool *p = calloc(1, sizeof(ThreadPool));
+    if (!p)
+        return NULL;
+    p->nworkers = nworkers;
+    p->ndeques = nworkers;
+    p->threads = calloc((size_t)nworkers, sizeof(pthread_t));
+    p->args = calloc((size_t)nworkers, sizeof(WorkerArg));
+    p->deques = calloc((size_t)nworkers, sizeof(WorkDeque));
+    if (!p->threads || !p->args || !p->deques)
+    {
+        free(p->threads);
+        free(p->args);
+        free(p->deques);
+        free(p);
+        return NULL;
+    }
+    atomic_init(&p->queued, 0);
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->work_cv, NULL);
+    pthread_cond_init(&p->space_cv, NULL);
+    for (int i = 0; i < nworkers; ++i)
+        pthread_mutex_init(&p->deques[i].lock, NULL);
+    for (int i = 0; i < nworkers; ++i)
+    {
+        p->args[i].pool = p;
+        p->args[i].id = i;
+        if (pthread_create(&p->threads[i], NULL, worker_main, &p->args[i]) != 0)
+        {
+            // workers already running may steal from any deque, so a partial
+            // pool cannot shrink safely: stop the ones we started and fail
+            pthread_mutex_lock(&p->lock);
+            p->shutdown = 1;
+            pthread_cond_broadcast(&p->work_cv);
+            pthread_mutex_unlock(&p->lock);
+            for (int j = 0; j < i; ++j)
+                pthread_join(p->threads[j], NULL);
+            p->nworkers = 0;
+            pool_finish(p);
+            return NULL;
+        }
+    }
+    return p;
+}
+
+int pool_worker_count(const ThreadPool *p)
+{
+    return p->nworkers;
+}
+
+int pool_submit(ThreadPool *p, pool_task_fn fn, void *arg)
+{
+    PoolTask t = {fn, arg};
+    for (;;)
+    {
+        for (int k = 0; k < p->nworkers; ++k)
+        {
+            int w = p->next;
+            p->next = (p->next + 1) % p->nworkers;
+            if (deque_push(&p->deques[w], &t))
+            {
+                atomic_fetch_add(&p->queued, 1);
+                pthread_mutex_lock(&p->lock);
+                pthread_cond_signal(&p->work_cv);
+                pthread_mutex_unlock(&p->lock);
+                return 0;
+            }
+        }
+        // every deque is full: wait for a worker to take something
+        pthread_mutex_lock(&p->lock);
+        while (atomic_load(&p->queued) >= p->nworkers * POOL_DEQUE_CAP)
+            pthread_cond_wait(&p->space_cv, &p->lock);
+        pthread_mutex_unlock(&p->lock);
+    }
+}
+
+void pool_finish(ThreadPool *p)
+{
+    pthread_mutex_lock(&p->lock);
+    p->shutdown = 1;
+    pthread_cond_broadcast(&p->work_cv);
+    pthread_mutex_unlock(&p->lock);
+    for (int i = 0; i < p->nworkers; ++i)
+        pthread_join(p->threads[i], NULL);
+    for (int i = 0; i < p->ndeques; ++i)
+        pthread_mutex_destroy(&p->deques[i].lock);
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->work_cv);
+    pthread_cond_destroy(&p->space_cv);
+    free(p->deques);
+    free(p->args);
+    free(p->threads);
+    free(p);
+}
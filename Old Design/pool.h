@@ -0,0 +1,37 @@
+#ifndef POOL_H
+#define POOL_H
+
+// Fixed-size worker pool with per-worker deques and work stealing.
+//
+// Tasks are pushed round-robin onto the workers' deques. A worker pops its
+// own deque from the newest end and, when that is empty, steals the oldest
+// task from another worker, so long-running hands never leave cores idle
+// while short ones are still queued elsewhere. The deques are bounded:
+// pool_submit blocks once every deque is full, which keeps memory flat no
+// matter how many tasks the producer generates.
+
+// capacity of each worker's deque
+#define POOL_DEQUE_CAP 256
+
+// task callback: receives the submitted argument and the id (0..n-1) of the
+// worker running it, so tasks can use per-worker scratch state.
+typedef void (*pool_task_fn)(void *arg, int worker_id);
+
+typedef struct ThreadPool ThreadPool;
+
+// number of online cores (at least 1)
+int pool_default_workers(void);
+
+// start a pool with nworkers threads (<= 0 means pool_default_workers()).
+// Returns NULL on failure.
+ThreadPool *pool_create(int nworkers);
+
+int pool_worker_count(const ThreadPool *p);
+
+// queue a task; blocks while all deques are full. Returns 0 on success.
+int pool_submit(ThreadPool *p, pool_task_fn fn, void *arg);
+
+// wait for every queued task to finish, then stop the workers and free the pool
+void pool_finish(ThreadPool *p);
+
+#endif // POOL_H
@@ -0,0 +1,171 @@
+#include "results.h"
+#include <stdlib.h>
+#include <string.h>
+
+uint64_t hand_key(const int *ids, int n)
+{
+    int sorted[MAX_HAND];
+    memcpy(sorted, ids, sizeof(int) * n);
+    for (int i = 1; i < n; ++i)
+        for (int j = i; j > 0 && sorted[j - 1] > sorted[j]; --j)
+        {
+            int t = sorted[j];
+            sorted[j] = sorted[j - 1];
+            sorted[j - 1] = t;
+        }
+    uint64_t k = 1;
+    for (int i = 0; i < n; ++i)
+        k = (k << 6) | (uint64_t)sorted[i];
+    return k;
+}
+
+int hand_key_ids(uint64_t key, int *ids_out)
+{
+    int n = 0;
+    while (key > 1 && n < MAX_HAND)
+    {
+        ids_out[n++] = (int)(key & 63);
+        key >>= 6;
+    }
+    // the low bits hold the last id; put them back in ascending order
+    for (int i = 0; i < n / 2; ++i)
+    {
+        int t = ids_out[i];
+        ids_out[i] = ids_out[n - 1 - i];
+        ids_out[n - 1 - i] = t;
+    }
+    return n;
+}
+
+int results_open(ResultWriter *w, const char *path, int max_turns, int nprob, const int *deck, int deck_size,
+                 int nworkers)
+{
+    memset(w, 0, sizeof(*w));
+    ResultsHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, RESULTS_MAGIC, 4);
+    hdr.version = RESULTS_VERSION;
+    hdr.max_turns = (uint32_t)max_turns;
+    hdr.nprob = (uint32_t)nprob;
+    hdr.record_size = (uint32_t)(sizeof(ResultRecord) + sizeof(float) * (size_t)nprob);
+    for (int i = 0; i < deck_size; ++i)
+        hdr.deck_counts[deck[i]]++;
+
+    w->f = fopen(path, "wb");
+    w->buffers = calloc((size_t)nworkers, sizeof(ResultBuffer));
+    if (!w->f || !w->buffers || fwrite(&hdr, sizeof(hdr), 1, w->f) != 1)
+    {
+        fprintf(stderr, "cannot write results %s\n", path);
+        if (w->f)
+            fclose(w->f);
+        free(w->buffers);
+        memset(w, 0, sizeof(*w));
+        return -1;
+    }
+    pthread_mutex_init(&w->lock, NULL);
+    w->nworkers = nworkers;
+    w->record_size = hdr.record_size;
+    w->nprob = nprob;
+    return 0;
+}
+
+static void flush_buffer(ResultWriter *w, ResultBuffer *b)
+{
+    if (b->used == 0)
+        return;
+    pthread_mutex_lock(&w->lock);
+    if (fwrite(b->data, 1, b->used, w->f) != b->used)
+        w->failed = 1;
+    pthread_mutex_unlock(&w->lock);
+    b->used = 0;
+}
+
+void results_add(ResultWriter *w, int worker, const ResultRecord *rec, const float *prob)
+{
+    ResultBuffer *b = &w->buffers[worker];
+    if (b->used + w->record_size > sizeof(b->data))
+        flush_buffer(w, b);
+    memcpy(b->data + b->used, rec, sizeof(*rec));
+    memcpy(b->data + b->used + sizeof(*rec), prob, sizeof(float) * (size_t)w->nprob);
+    b->used += w->record_size;
+}
+
+int results_close(ResultWriter *w)
+{
+    if (!w->f)
+        return -1;
+    for (int i = 0; i < w->nworkers; ++i)
+        flush_buffer(w, &w->buffers[i]);
+    int failed = w->failed;
+    if (fclose(w->f) != 0)
+        failed = 1;
+    pthread_mutex_destroy(&w->lock);
+    free(w->buffers);
+    memset(w, 0, sizeof(*w));
+    if (failed)
+        fprintf(stderr, "error writing results\n");
+    return failed ? -1 : 0;
+}
+
+int results_read(ResultsFile *rf, const char *path)
+{
+    memset(rf, 0, sizeof(*rf));
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        fprintf(stderr, "cannot open results %s\n", path);
+        return -1;
+    }
+    if (fread(&rf->hdr, sizeof(rf->hdr), 1, f) != 1 || memcmp(rf->hdr.magic, RESULTS_MAGIC, 4) != 0 ||
+        rf->hdr.version != RESULTS_VERSION || rf->hdr.nprob == 0 ||
+        rf->hdr.record_size != sizeof(ResultRecord) + sizeof(float) * rf->hdr.nprob)
+    {
+        fprintf(stderr, "%s is not a results file\n", path);
+        fclose(f);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f) - (long)sizeof(rf->hdr);
+    fseek(f, (long)sizeof(rf->hdr), SEEK_SET);
+    rf->count = size / (long)rf->hdr.record_size;
+    rf->records = malloc((size_t)rf->count * rf->hdr.record_size + 1);
+    if (!rf->records || fread(rf->records, rf->hdr.record_size, (size_t)rf->count, f) != (size_t)rf->count)
+    {
+        fprintf(stderr, "cannot read results %s\n", path);
+        free(rf->records);
+        rf->records = NULL;
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return 0;
+}
+
+void results_free(ResultsFile *rf)
+{
+    free(rf->records);
+    memset(rf, 0, sizeof(*rf));
+}
+
+int results_write_csv(const ResultsFile *rf, FILE *out)
+{
+    int first_turn = (int)(rf->hdr.max_turns - rf->hdr.nprob) + 1;
+    fprintf(out, "hand,weight");
+    for (uint32_t t = 0; t < rf->hdr.nprob; ++t)
+        fprintf(out, ",p_turn%d", first_turn + (int)t);
+    fprintf(out, ",nodes,seconds\n");
+    for (long i = 0; i < rf->count; ++i)
+    {
+        const ResultRecord *r = results_record(rf, i);
+        const float *prob = results_prob(rf, i);
+        int ids[MAX_HAND];
+        int n = hand_key_ids(r->hand_key, ids);
+        for (int c = 0; c < n; ++c)
+            fprintf(out, c ? "-%d" : "%d", ids[c]);
+        fprintf(out, ",%.10g", r->weight);
+        for (uint32_t t = 0; t < rf->hdr.nprob; ++t)
+            fprintf(out, ",%.8f", prob[t]);
+        fprintf(out, ",%llu,%.6f\n", (unsigned long long)r->nodes, r->seconds);
+    }
+    return ferror(out) ? -1 : 0;
+}
@@ -0,0 +1,106 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "game.h"
+
+// Binary per-hand results of an exhaustive run.
+//
+// The file is a header (run settings and deck composition) followed by
+// fixed-size records, one per solved hand, in completion order: the hand's
+// key (see hand_key), its weight, the solver's node count and time, and
+// P(win) by turn. Runs without per-turn results store only the last turn.
+// Workers append records to their own buffer and only take the file lock
+// to write a full buffer, so threads never contend on stdout or per line.
+
+#define RESULTS_MAGIC "SDRS"
+#define RESULTS_VERSION 1
+
+// bytes each worker buffers before writing
+#define RESULTS_BUFFER_SIZE (64 * 1024)
+
+typedef struct ResultsHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t max_turns;
+    uint32_t nprob;       // probabilities per record: max_turns, or 1 (last turn only)
+    uint32_t record_size; // bytes per record
+    uint8_t deck_counts[MAX_CARD_IDS];
+} ResultsHeader;
+
+// fixed part of a record; followed by float prob[nprob]
+typedef struct ResultRecord
+{
+    uint64_t hand_key;
+    double weight;
+    uint64_t nodes;
+    float seconds;
+    uint32_t pad;
+} ResultRecord;
+
+typedef struct ResultBuffer
+{
+    unsigned char data[RESULTS_BUFFER_SIZE];
+    size_t used;
+} ResultBuffer;
+
+typedef struct ResultWriter
+{
+    FILE *f;
+    pthread_mutex_t lock; // guards f
+    ResultBuffer *buffers; // one per worker
+    int nworkers;
+    size_t record_size;
+    int nprob;
+    int failed;
+} ResultWriter;
+
+// exact key of a hand multiset: a leading 1 bit, then its ascending card
+// ids, 6 bits each
+uint64_t hand_key(const int *ids, int n);
+
+// card ids of a key, ascending; returns how many
+int hand_key_ids(uint64_t key, int *ids_out);
+
+// Create path and write the header. nprob is max_turns or 1. Returns 0 on
+// success, -1 on error.
+int results_open(ResultWriter *w, const char *path, int max_turns, int nprob, const int *deck, int deck_size,
+                 int nworkers);
+
+// Append one record from worker `worker` (prob has nprob entries)
+void results_add(ResultWriter *w, int worker, const ResultRecord *rec, const float *prob);
+
+// Flush every worker's buffer and close the file. Returns 0 if everything
+// was written.
+int results_close(ResultWriter *w);
+
+// A results file read back into memory
+typedef struct ResultsFile
+{
+    ResultsHeader hdr;
+    unsigned char *records;
+    long count;
+} ResultsFile;
+
+int results_read(ResultsFile *rf, const char *path);
+void results_free(ResultsFile *rf);
+
+static inline const ResultRecord *results_record(const ResultsFile *rf, long i)
+{
+    return (const ResultRecord *)(rf->records + (size_t)i * rf->hdr.record_size);
+}
+
+static inline const float *results_prob(const ResultsFile *rf, long i)
+{
+    return (const float *)(rf->records + (size_t)i * rf->hdr.record_size + sizeof(ResultRecord));
+}
+
+// Write rf as CSV ("hand,weight,p_turn...,nodes,seconds"; hand is
+// "id-id-...-id" as in results.csv) to out. Returns 0 on success.
+int results_write_csv(const ResultsFile *rf, FILE *out);
+
+#endif // RESULTS_H
@@ -0,0 +1,114 @@
+#include "ttable.h"
+#include <stdlib.h>
+#include <string.h>
+
+// key 0 is the empty marker; fold it onto another value
+static inline uint64_t st_slot_key(uint64_t key)
+{
+    return key ? key : 0x9e3779b97f4a7c15ULL;
+}
+
+static StateEntry *st_alloc(StateTable *t, size_t cap)
+{
+    if (t->arena)
+        return arena_calloc(t->arena, cap, sizeof(StateEntry));
+    return calloc(cap, sizeof(StateEntry));
+}
+
+int st_init_arena(StateTable *t, Arena *arena, size_t min_cap)
+{
+    size_t cap = 1024;
+    while (cap < min_cap * 2)
+        cap <<= 1;
+    t->arena = arena;
+    t->entries = st_alloc(t, cap);
+    t->cap = t->entries ? cap : 0;
+    t->count = 0;
+    return t->entries ? 0 : -1;
+}
+
+int st_init(StateTable *t, size_t min_cap)
+{
+    return st_init_arena(t, NULL, min_cap);
+}
+
+void st_clear(StateTable *t)
+{
+    if (t->entries)
+        memset(t->entries, 0, t->cap * sizeof(StateEntry));
+    t->count = 0;
+}
+
+void st_free(StateTable *t)
+{
+    if (!t->arena)
+        free(t->entries);
+    t->entries = NULL;
+    t->cap = 0;
+    t->count = 0;
+}
+
+StateEntry *st_find(const StateTable *t, uint64_t key)
+{
+    if (!t->cap)
+        return NULL;
+    key = st_slot_key(key);
+    size_t mask = t->cap - 1;
+    for (size_t i = (size_t)key & mask;; i = (i + 1) & mask)
+    {
+        StateEntry *e = &t->entries[i];
+        if (e->key == key)
+            return e;
+        if (e->key == 0)
+            return NULL;
+    }
+}
+
+static int st_grow(StateTable *t)
+{
+    size_t ncap = t->cap ? t->cap * 2 : 1024;
+    StateEntry *ne = st_alloc(t, ncap);
+    if (!ne)
+        return -1;
+    size_t mask = ncap - 1;
+    for (size_t j = 0; j < t->cap; ++j)
+    {
+        StateEntry *e = &t->entries[j];
+        if (!e->key)
+            continue;
+        size_t i = (size_t)e->key & mask;
+        while (ne[i].key)
+            i = (i + 1) & mask;
+        ne[i] = *e;
+    }
+    if (!t->arena)
+        free(t->entries);
+    t->entries = ne;
+    t->cap = ncap;
+    return 0;
+}
+
+StateEntry *st_insert(StateTable *t, uint64_t key, int *found)
+{
+    if ((t->count + 1) * 2 > t->cap && st_grow(t) != 0)
+        return NULL;
+    key = st_slot_key(key);
+    size_t mask = t->cap - 1;
+    for (size_t i = (size_t)key & mask;; i = (i + 1) & mask)
+    {
+        StateEntry *e = &t->entries[i];
+        if (e->key == key)
+        {
+            *found = 1;
+            return e;
+        }
+        if (e->key == 0)
+        {
+            e->key = key;
+            e->value = 0.0;
+            t->count++;
+            *found = 0;
+            return e;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef TTABLE_H
+#define TTABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+// Open-addressing transposition table keyed by 64-bit state keys.
+//
+// Entries are 16 bytes (key + value) stored inline, four to a cache line,
+// with linear probing and a power-of-two capacity that doubles at 50% load,
+// so a lookup is normally a single cache miss. Key 0 marks an empty slot;
+// callers never see it because st_slot remaps it.
+typedef struct StateEntry
+{
+    uint64_t key;
+    double value;
+} StateEntry;
+
+typedef struct StateTable
+{
+    StateEntry *entries;
+    size_t cap; // power of two
+    size_t count;
+    Arena *arena; // if set, entry arrays come from here and are never freed
+} StateTable;
+
+// initialise with room for at least min_cap entries; returns 0 on success
+int st_init(StateTable *t, size_t min_cap);
+
+// same, allocating from `arena`: the table is released by resetting the
+// arena, and st_free only forgets it
+int st_init_arena(StateTable *t, Arena *arena, size_t min_cap);
+
+// drop every entry but keep the allocation
+void st_clear(StateTable *t);
+
+void st_free(StateTable *t);
+
+// find key; returns its entry or NULL if absent
+StateEntry *st_find(const StateTable *t, uint64_t key);
+
+// find or insert key. *found is set to 1 if it was already present; a new
+// entry starts with value 0. Returns NULL only if growing the table failed.
+StateEntry *st_insert(StateTable *t, uint64_t key, int *found);
+
+#endif // TTABLE_H
@@ -0,0 +1,475 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vars.h"
+#include "carddb.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Largest database: card ids must stay below NO_CARD. */
+#define CARDDB_MAX_CARDS 255
+
+static const struct
+{
+    const char *name;
+    int type;
+} type_names[] = {
+    {"creature", CREATURE},
+    {"instant", INSTANT},
+    {"sorcery", SORCERY},
+    {"artifact", ARTIFACT},
+    {"enchantment", ENCHANTMENT},
+    {"land", LAND},
+    {"mdfc", MDFC},
+};
+
+static const struct
+{
+    const char *name;
+    int bit;
+} supertype_names[] = {
+    {"basic", SUPERTYPE_BASIC},
+};
+
+/* FNV-1a with the seed folded into the offset basis */
+static uint32_t name_hash(const char *s, uint32_t seed)
+{
+    uint64_t h = 14695981039346656037ULL ^ ((uint64_t)seed * 0x9E3779B97F4A7C15ULL);
+    for (; *s; ++s)
+    {
+        h ^= (unsigned char)*s;
+        h *= 1099511628211ULL;
+    }
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+int carddb_lookup(const CardDb *db, const char *name)
+{
+    const CardDbHeader *hdr = db->hdr;
+    if (!hdr || hdr->count == 0)
+        return -1;
+    uint32_t b = name_hash(name, 0) % hdr->nbuckets;
+    uint32_t slot = name_hash(name, db->disp[b]) % hdr->count;
+    int id = db->slots[slot];
+    if (strcmp(carddb_string(db, db->cards[id].name_off), name) != 0)
+        return -1;
+    return id;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Compiler */
+
+/* growable string pool; offset 0 holds the empty string */
+typedef struct
+{
+    char *data;
+    size_t len;
+    size_t cap;
+} StrPool;
+
+static uint32_t pool_add(StrPool *p, const char *s)
+{
+    size_t n = strlen(s) + 1;
+    if (p->len + n > p->cap)
+    {
+        size_t cap = p->cap ? p->cap * 2 : 1024;
+        while (cap < p->len + n)
+            cap *= 2;
+        char *d = realloc(p->data, cap);
+        if (!d)
+            return UINT32_MAX;
+        p->data = d;
+        p->cap = cap;
+    }
+    memcpy(p->data + p->len, s, n);
+    p->len += n;
+    return (uint32_t)(p->len - n);
+}
+
+static char *trim(char *s)
+{
+    while (*s == ' ' || *s == '\t')
+        ++s;
+    char *end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r'))
+        *--end = '\0';
+    return s;
+}
+
+static int parse_small(const char *s, uint8_t *out)
+{
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || v < 0 || v > 255)
+        return -1;
+    *out = (uint8_t)v;
+    return 0;
+}
+
+/* "R", "UR", "RUG", ... -> MANA_BIT mask; "-" is colorless */
+static int parse_colors(const char *s, uint8_t *out)
+{
+    *out = 0;
+    if (strcmp(s, "-") == 0)
+        return 0;
+    for (; *s; ++s)
+    {
+        if (*s == 'R')
+            *out |= MANA_BIT(RED);
+        else if (*s == 'U')
+            *out |= MANA_BIT(BLUE);
+        else if (*s == 'G')
+            *out |= MANA_BIT(GREEN);
+        else
+            return -1;
+    }
+    return 0;
+}
+
+/* "basic", ... -> SUPERTYPE_* bits; "-" is none */
+static int parse_supertype(const char *s, uint8_t *out)
+{
+    *out = 0;
+    if (strcmp(s, "-") == 0)
+        return 0;
+    for (size_t i = 0; i < sizeof(supertype_names) / sizeof(supertype_names[0]); ++i)
+    {
+        if (strcmp(s, supertype_names[i].name) == 0)
+        {
+            *out = (uint8_t)supertype_names[i].bit;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* Parse one
+   "name|type|supertype|generic|red|blue|green|power|toughness|produces|effect"
+   line */
+static int parse_card(char *line, StrPool *pool, CardDbRecord *rec)
+{
+    char *field[11];
+    int n = 0;
+    char *p = line;
+    for (;;)
+    {
+        if (n == 11)
+            return -1;
+        field[n++] = p;
+        char *bar = strchr(p, '|');
+        if (!bar)
+            break;
+        *bar = '\0';
+        p = bar + 1;
+    }
+    if (n != 11)
+        return -1;
+    for (int i = 0; i < 11; ++i)
+        field[i] = trim(field[i]);
+    if (field[0][0] == '\0')
+        return -1;
+
+    memset(rec, 0, sizeof(*rec));
+    int type = -1;
+    for (size_t i = 0; i < sizeof(type_names) / sizeof(type_names[0]); ++i)
+    {
+        if (strcmp(field[1], type_names[i].name) == 0)
+            type = type_names[i].type;
+    }
+    if (type < 0)
+        return -1;
+    rec->type = (uint8_t)type;
+    if (parse_supertype(field[2], &rec->supertype) || parse_small(field[3], &rec->cost_generic) ||
+        parse_small(field[4], &rec->cost_color[0]) || parse_small(field[5], &rec->cost_color[1]) ||
+        parse_small(field[6], &rec->cost_color[2]) || parse_small(field[7], &rec->power) ||
+        parse_small(field[8], &rec->toughness) || parse_colors(field[9], &rec->produces))
+        return -1;
+
+    rec->name_off = pool_add(pool, field[0]);
+    rec->effect_off = strcmp(field[10], "-") == 0 ? 0 : pool_add(pool, field[10]);
+    if (rec->name_off == UINT32_MAX || rec->effect_off == UINT32_MAX)
+        return -1;
+    return 0;
+}
+
+/* Find a displacement for every bucket so that all names land in distinct
+   slots, placing the largest buckets first. Fails on duplicate names. */
+static int build_index(const CardDbRecord *cards, uint32_t n, const char *strings,
+                       uint32_t nbuckets, uint32_t *disp, uint8_t *slots)
+{
+    uint32_t *bucket_of = malloc(sizeof(uint32_t) * n);
+    uint32_t *size = calloc(nbuckets, sizeof(uint32_t));
+    uint32_t *order = malloc(sizeof(uint32_t) * nbuckets);
+    uint8_t *taken = calloc(n, 1);
+    int rc = -1;
+    if (!bucket_of || !size || !order || !taken)
+        goto out;
+
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        bucket_of[i] = name_hash(strings + cards[i].name_off, 0) % nbuckets;
+        size[bucket_of[i]]++;
+    }
+    for (uint32_t b = 0; b < nbuckets; ++b)
+        order[b] = b;
+    // insertion sort by size, largest first; nbuckets is small
+    for (uint32_t i = 1; i < nbuckets; ++i)
+    {
+        uint32_t b = order[i], j = i;
+        while (j > 0 && size[order[j - 1]] < size[b])
+        {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = b;
+    }
+
+    for (uint32_t o = 0; o < nbuckets; ++o)
+    {
+        uint32_t b = order[o];
+        uint32_t members[CARDDB_MAX_CARDS];
+        uint32_t m = 0;
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            if (bucket_of[i] == b)
+                members[m++] = i;
+        }
+        if (m == 0)
+        {
+            disp[b] = 0;
+            continue;
+        }
+        // equal names always share a bucket, so this finds every duplicate
+        for (uint32_t x = 0; x < m; ++x)
+            for (uint32_t y = x + 1; y < m; ++y)
+                if (strcmp(strings + cards[members[x]].name_off, strings + cards[members[y]].name_off) == 0)
+                {
+                    fprintf(stderr, "carddb: duplicate card name \"%s\"\n", strings + cards[members[x]].name_off);
+                    goto out;
+                }
+
+        uint32_t d;
+        for (d = 1; d < (1u << 24); ++d)
+        {
+            uint32_t s[CARDDB_MAX_CARDS];
+            uint32_t k;
+            for (k = 0; k < m; ++k)
+            {
+                s[k] = name_hash(strings + cards[members[k]].name_off, d) % n;
+                if (taken[s[k]])
+                    break;
+                uint32_t j;
+                for (j = 0; j < k && s[j] != s[k]; ++j)
+                    ;
+                if (j < k)
+                    break;
+            }
+            if (k == m)
+            {
+                for (k = 0; k < m; ++k)
+                {
+                    taken[s[k]] = 1;
+                    slots[s[k]] = (uint8_t)members[k];
+                }
+                break;
+            }
+        }
+        if (d == (1u << 24))
+        {
+            fprintf(stderr, "carddb: could not build the name index\n");
+            goto out;
+        }
+        disp[b] = d;
+    }
+    rc = 0;
+out:
+    free(bucket_of);
+    free(size);
+    free(order);
+    free(taken);
+    return rc;
+}
+
+int carddb_compile(const char *src_path, void **image, size_t *size)
+{
+    FILE *f = fopen(src_path, "r");
+    if (!f)
+        return -1;
+
+    CardDbRecord cards[CARDDB_MAX_CARDS];
+    uint32_t n = 0;
+    StrPool pool = {0};
+    pool_add(&pool, "");
+    int version = 0;
+    int rc = -1;
+    char line[512];
+    int lineno = 0;
+
+    while (fgets(line, sizeof(line), f))
+    {
+        ++lineno;
+        char *s = trim(line);
+        if (*s == '\0' || *s == '#')
+            continue;
+        if (strncmp(s, "version ", 8) == 0)
+        {
+            version = atoi(s + 8);
+            continue;
+        }
+        if (version != CARDDB_VERSION)
+        {
+            fprintf(stderr, "%s:%d: expected \"version %d\" before the first card\n", src_path, lineno, CARDDB_VERSION);
+            goto out;
+        }
+        if (n == CARDDB_MAX_CARDS)
+        {
+            fprintf(stderr, "%s:%d: more than %d cards\n", src_path, lineno, CARDDB_MAX_CARDS);
+            goto out;
+        }
+        if (parse_card(s, &pool, &cards[n]) != 0)
+        {
+            fprintf(stderr, "%s:%d: malformed card line\n", src_path, lineno);
+            goto out;
+        }
+        ++n;
+    }
+
+    {
+        uint32_t nbuckets = n / 2 + 1;
+        CardDbHeader hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, CARDDB_MAGIC, 4);
+        hdr.version = CARDDB_VERSION;
+        hdr.count = n;
+        hdr.nbuckets = nbuckets;
+        hdr.cards_off = sizeof(CardDbHeader);
+        hdr.disp_off = hdr.cards_off + n * (uint32_t)sizeof(CardDbRecord);
+        hdr.slots_off = hdr.disp_off + nbuckets * (uint32_t)sizeof(uint32_t);
+        hdr.strings_off = hdr.slots_off + n;
+        hdr.size = hdr.strings_off + (uint32_t)pool.len;
+
+        uint8_t *img = calloc(1, hdr.size);
+        if (!img)
+            goto out;
+        memcpy(img, &hdr, sizeof(hdr));
+        memcpy(img + hdr.cards_off, cards, n * sizeof(CardDbRecord));
+        memcpy(img + hdr.strings_off, pool.data, pool.len);
+        if (build_index(cards, n, pool.data, nbuckets, (uint32_t *)(img + hdr.disp_off), img + hdr.slots_off) != 0)
+        {
+            free(img);
+            goto out;
+        }
+        *image = img;
+        *size = hdr.size;
+        rc = 0;
+    }
+out:
+    fclose(f);
+    free(pool.data);
+    return rc;
+}
+
+int carddb_write(const char *path, const void *image, size_t size)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return -1;
+    size_t w = fwrite(image, 1, size, f);
+    if (fclose(f) != 0 || w != size)
+        return -1;
+    return 0;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Loader */
+
+static int attach(CardDb *db, void *image, size_t size)
+{
+    const CardDbHeader *hdr = image;
+    if (size < sizeof(CardDbHeader) || memcmp(hdr->magic, CARDDB_MAGIC, 4) != 0 ||
+        hdr->version != CARDDB_VERSION || hdr->size != size || hdr->count > CARDDB_MAX_CARDS ||
+        hdr->nbuckets == 0 || hdr->strings_off > size)
+        return -1;
+    db->hdr = hdr;
+    db->cards = (const CardDbRecord *)((const char *)image + hdr->cards_off);
+    db->disp = (const uint32_t *)((const char *)image + hdr->disp_off);
+    db->slots = (const uint8_t *)image + hdr->slots_off;
+    db->strings = (const char *)image + hdr->strings_off;
+    db->image = image;
+    db->size = size;
+    return 0;
+}
+
+int carddb_attach(CardDb *db, void *image, size_t size)
+{
+    memset(db, 0, sizeof(*db));
+    if (attach(db, image, size) != 0)
+    {
+        free(image);
+        return -1;
+    }
+    return 0;
+}
+
+int carddb_open(CardDb *db, const char *path)
+{
+    memset(db, 0, sizeof(*db));
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return -1;
+    }
+    void *image = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED)
+        return -1;
+    if (attach(db, image, (size_t)st.st_size) != 0)
+    {
+        munmap(image, (size_t)st.st_size);
+        return -1;
+    }
+    db->mapped = 1;
+    return 0;
+#else
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return -1;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    void *image = len > 0 ? malloc((size_t)len) : NULL;
+    if (!image || fread(image, 1, (size_t)len, f) != (size_t)len)
+    {
+        free(image);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return carddb_attach(db, image, (size_t)len);
+#endif
+}
+
+void carddb_close(CardDb *db)
+{
+    if (!db->image)
+        return;
+#ifndef _WIN32
+    if (db->mapped)
+        munmap(db->image, db->size);
+    else
+#endif
+        free(db->image);
+    memset(db, 0, sizeof(*db));
+}
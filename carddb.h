@@ -0,0 +1,84 @@
+#ifndef STORM_DECK_CARDDB_H
+#define STORM_DECK_CARDDB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Compiled card database (cards.db).
+
+   cards.txt is compiled once into a flat, position-independent image that
+   is mapped read-only at startup: a header, one fixed-size record per card,
+   a minimal perfect hash over the card names and a string pool. Loading is
+   a single mmap plus a header check; nothing is parsed or copied.
+
+   The name index is hash-and-displace: a name's first hash picks a bucket,
+   and the bucket's displacement seeds a second hash that picks the name's
+   slot. Every name gets its own slot, so a lookup is two hashes and one
+   strcmp to reject unknown names. */
+
+#define CARDDB_MAGIC "SDCB"
+#define CARDDB_VERSION 3
+
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t count;       /* number of card records */
+    uint32_t nbuckets;    /* number of displacement entries */
+    uint32_t cards_off;   /* CardDbRecord[count] */
+    uint32_t disp_off;    /* uint32_t[nbuckets] */
+    uint32_t slots_off;   /* uint8_t[count]: hash slot -> card id */
+    uint32_t strings_off; /* NUL-terminated strings; offset 0 is "" */
+    uint32_t size;        /* total image size in bytes */
+} CardDbHeader;
+
+typedef struct
+{
+    uint32_t name_off;   /* into the string pool */
+    uint32_t effect_off; /* effect name in the string pool; 0 for none */
+    uint8_t type;
+    uint8_t supertype; /* SUPERTYPE_* bits */
+    uint8_t cost_generic;
+    uint8_t cost_color[3]; /* red, blue, green */
+    uint8_t power;
+    uint8_t toughness;
+    uint8_t produces; /* lands: MANA_BIT mask of the mana made */
+} CardDbRecord;
+
+typedef struct
+{
+    const CardDbHeader *hdr;
+    const CardDbRecord *cards;
+    const uint32_t *disp;
+    const uint8_t *slots;
+    const char *strings;
+    void *image;
+    size_t size;
+    int mapped; /* image came from mmap rather than malloc */
+} CardDb;
+
+/* Parse the text database at src_path into a malloc'd image. Reports
+   syntax errors and duplicate names on stderr. Returns 0 on success. */
+int carddb_compile(const char *src_path, void **image, size_t *size);
+
+/* Write an image to path. Returns 0 on success. */
+int carddb_write(const char *path, const void *image, size_t size);
+
+/* Map a compiled database. Returns 0 on success, -1 if the file is missing
+   or is not a database of this version. */
+int carddb_open(CardDb *db, const char *path);
+
+/* Attach to an image built by carddb_compile; db takes ownership. */
+int carddb_attach(CardDb *db, void *image, size_t size);
+
+void carddb_close(CardDb *db);
+
+/* Card id for an exact name, or -1 if the database has no such card. */
+int carddb_lookup(const CardDb *db, const char *name);
+
+static inline const char *carddb_string(const CardDb *db, uint32_t off)
+{
+    return db->strings + off;
+}
+
+#endif /* STORM_DECK_CARDDB_H */
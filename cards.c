@@ -3,287 +3,258 @@
 #include <stdio.h>
 #include "vars.h"
 #include "cards.h"
-
-/* portable strdup replacement */
-static char *xstrdup(const char *s)
-{
-    if (!s)
-        return NULL;
-    size_t n = strlen(s) + 1;
-    char *p = (char *)malloc(n);
-    if (p)
-        memcpy(p, s, n);
-    return p;
-}
-
-static Card drawCard(int deck[])
-{
-    /* Find the first non-empty slot (non -1), remove it from the deck
-       so it can't be drawn again, and return the corresponding card. */
-    Card empty = {0};
-    for (int i = 0; i < DECK_SIZE; ++i)
-    {
-        int idx = deck[i];
-        if (idx >= 0)
-        {
-            deck[i] = -1; /* mark as drawn */
-            return library[idx];
-        }
-    }
-
-    return empty;
-}
-
-static void drawCardTohand(GameState *gs)
-{
-    for (int i = 0; i < HAND_SIZE; ++i)
-    {
-        if (gs->hand[i].name == NULL)
-        {
-            gs->hand[i] = drawCard(gs->deck);
-            return;
-        }
-    }
-}
-
-static void impulse_draw(GameState *gs, int idx)
-{
-    for (int i = 0; i < DECK_SIZE; ++i)
-    {
-        if (gs->exile[i].name == NULL)
-        {
-            gs->exile[i] = drawCard(gs->deck);
-            return;
-        }
-    }
-    (void)idx;
-}
-
-static void addToBattlefield(GameState *gs, Card card)
-{
-    for (int i = 0; i < DECK_SIZE; ++i)
-    {
-        if (gs->battlefield[i].name == NULL)
-        {
-            gs->battlefield[i] = card;
-            return;
-        }
-    }
-}
+#include "carddb.h"
+#include "game.h"
 
 /* Define the library (templates) */
-Card library[LIBRARY_SIZE];
+Card library[MAX_LIBRARY];
+int library_count;
+
+/* compiled card database; library[] names point into it */
+static CardDb card_db;
 
-/* effect implementations — these now receive a GameState* so they can
-   mutate the game state. Keep bodies small here; you can expand later. */
-static void effect_artists_talent(GameState *gs, int idx)
+/* effect implementations — these receive a GameState* so they can mutate
+   the game state, plus the CardId of the card being cast. castCard moves
+   the card itself to its zone afterwards. Keep bodies small here; you can
+   expand later. */
+static void effect_artists_talent(GameState *gs, CardId id)
 {
-    Card target = gs->hand[idx];
-    addToBattlefield(gs, target);
+    (void)gs;
+    (void)id;
 }
-static void effect_desperate_ritual(GameState *gs, int idx)
+static void effect_desperate_ritual(GameState *gs, CardId id)
 {
     if (!gs)
         return;
-    gs->player_mana[RED] += 3;
-    (void)idx;
+    gs->player_mana[MANA_BIT(RED)] += 3;
+    (void)id;
 }
-static void effect_flame_of_anor(GameState *gs, int idx)
+static void effect_flame_of_anor(GameState *gs, CardId id)
 {
-    gs->hand[idx] = drawCard(gs->deck);
-    drawCardTohand(gs);
-    (void)idx;
+    // an empty library ends the draws
+    if (drawCardToHand(gs) == 0)
+        drawCardToHand(gs);
+    (void)id;
 }
-static void effect_grapeshot(GameState *gs, int idx)
+static void effect_grapeshot(GameState *gs, CardId id)
 {
-    gs->opponent_life -= 1 + (gs->storm_count);
-    (void)idx;
+    damageOpponent(gs, 1 + gs->storm_count);
+    (void)id;
 }
-static void effect_manamorphose(GameState *gs, int idx)
+static void effect_manamorphose(GameState *gs, CardId id)
 {
     if (!gs)
         return;
-    gs->player_mana[RED] += 2;
-    (void)idx;
+    /* two mana in any combination of colors, chosen when it is spent */
+    gs->player_mana[MANA_ANY] += 2;
+    (void)id;
 }
-static void effect_past_in_flames(GameState *gs, int idx)
+static void effect_past_in_flames(GameState *gs, CardId id)
 {
     (void)gs;
-    (void)idx;
+    (void)id;
 }
-static void effect_pyretic_ritual(GameState *gs, int idx)
+static void effect_pyretic_ritual(GameState *gs, CardId id)
 {
     if (!gs)
         return;
-    gs->player_mana[RED] += 3;
-    (void)idx;
+    gs->player_mana[MANA_BIT(RED)] += 3;
+    (void)id;
 }
-static void effect_ral(GameState *gs, int idx)
+static void effect_ral(GameState *gs, CardId id)
 {
-    Card target = gs->hand[idx];
-    addToBattlefield(gs, target);
+    (void)gs;
+    (void)id;
 }
-static void effect_reckless_impulse(GameState *gs, int idx)
+static void effect_reckless_impulse(GameState *gs, CardId id)
 {
-    impulse_draw(gs, idx);
-    impulse_draw(gs, idx);
-    (void)idx;
+    if (exileTop(gs) == 0)
+        exileTop(gs);
+    (void)id;
 }
-static void effect_ruby_medallion(GameState *gs, int idx)
+static void effect_ruby_medallion(GameState *gs, CardId id)
 {
-    Card target = gs->hand[idx];
-    addToBattlefield(gs, target);
+    (void)gs;
+    (void)id;
 }
-static void effect_stormcatch_mentor(GameState *gs, int idx)
+static void effect_stormcatch_mentor(GameState *gs, CardId id)
 {
-    Card target = gs->hand[idx];
-    addToBattlefield(gs, target);
+    (void)gs;
+    (void)id;
 }
-static void effect_stormscale_scion(GameState *gs, int idx)
+static void effect_stormscale_scion(GameState *gs, CardId id)
 {
-    Card target = gs->hand[idx];
-    for (int i = -1; i < gs->storm_count; ++i)
-    {
-        addToBattlefield(gs, target);
-    }
+    /* storm: one token copy per spell cast before it this turn; castCard
+       puts the card itself onto the battlefield */
+    gs->tokens += gs->storm_count;
+    (void)id;
 }
-static void effect_valakut_awakening(GameState *gs, int idx)
+static void effect_valakut_awakening(GameState *gs, CardId id)
 {
-    gs->hand[idx] = drawCard(gs->deck);
-    (void)idx;
+    drawCardToHand(gs);
+    (void)id;
 }
-static void effect_wish(GameState *gs, int idx)
+static void effect_wish(GameState *gs, CardId id)
 {
     (void)gs;
-    (void)idx;
+    (void)id;
 }
-static void effect_wrenn_resolve(GameState *gs, int idx)
+static void effect_wrenn_resolve(GameState *gs, CardId id)
 {
-    impulse_draw(gs, idx);
-    impulse_draw(gs, idx);
-    (void)idx;
+    if (exileTop(gs) == 0)
+        exileTop(gs);
+    (void)id;
 }
-static void effect_blood_moon(GameState *gs, int idx)
+static void effect_blood_moon(GameState *gs, CardId id)
 {
-    Card target = gs->hand[idx];
-    addToBattlefield(gs, target);
+    (void)gs;
+    (void)id;
 }
-static void effect_brotherhoods_end(GameState *gs, int idx)
+static void effect_brotherhoods_end(GameState *gs, CardId id)
 {
     (void)gs;
-    (void)idx;
+    (void)id;
 }
-static void effect_collective_resistance(GameState *gs, int idx)
+static void effect_collective_resistance(GameState *gs, CardId id)
 {
     (void)gs;
-    (void)idx;
+    (void)id;
 }
-static void effect_escape_to_the_wilds(GameState *gs, int idx)
+static void effect_escape_to_the_wilds(GameState *gs, CardId id)
 {
-    impulse_draw(gs, idx);
-    impulse_draw(gs, idx);
-    impulse_draw(gs, idx);
-    impulse_draw(gs, idx);
-    impulse_draw(gs, idx);
-    (void)idx;
+    for (int i = 0; i < 5; ++i)
+    {
+        if (exileTop(gs) < 0)
+            break;
+    }
+    (void)id;
 }
-static void effect_galvanic_relay(GameState *gs, int idx)
+static void effect_galvanic_relay(GameState *gs, CardId id)
 {
     for (int i = 0; i < gs->storm_count; ++i)
-        impulse_draw(gs, idx);
-    (void)idx;
+    {
+        if (exileTop(gs) < 0)
+            break;
+    }
+    (void)id;
 }
-static void effect_into_the_flood_maw(GameState *gs, int idx)
+static void effect_into_the_flood_maw(GameState *gs, CardId id)
 {
     (void)gs;
-    (void)idx;
+    (void)id;
 }
-static void effect_surgical_extraction(GameState *gs, int idx)
+static void effect_surgical_extraction(GameState *gs, CardId id)
 {
     (void)gs;
-    (void)idx;
+    (void)id;
 }
-static void effect_veil_of_summer(GameState *gs, int idx)
+static void effect_veil_of_summer(GameState *gs, CardId id)
 {
     (void)gs;
-    (void)idx;
+    (void)id;
 }
 
-void init_cards(void)
+/* effects by the name used in cards.txt */
+static const struct
+{
+    const char *name;
+    void (*fn)(GameState *, CardId);
+} effects[] = {
+    {"artists_talent", effect_artists_talent},
+    {"desperate_ritual", effect_desperate_ritual},
+    {"flame_of_anor", effect_flame_of_anor},
+    {"grapeshot", effect_grapeshot},
+    {"manamorphose", effect_manamorphose},
+    {"past_in_flames", effect_past_in_flames},
+    {"pyretic_ritual", effect_pyretic_ritual},
+    {"ral", effect_ral},
+    {"reckless_impulse", effect_reckless_impulse},
+    {"ruby_medallion", effect_ruby_medallion},
+    {"stormcatch_mentor", effect_stormcatch_mentor},
+    {"stormscale_scion", effect_stormscale_scion},
+    {"valakut_awakening", effect_valakut_awakening},
+    {"wish", effect_wish},
+    {"wrenn_resolve", effect_wrenn_resolve},
+    {"blood_moon", effect_blood_moon},
+    {"brotherhoods_end", effect_brotherhoods_end},
+    {"collective_resistance", effect_collective_resistance},
+    {"escape_to_the_wilds", effect_escape_to_the_wilds},
+    {"galvanic_relay", effect_galvanic_relay},
+    {"into_the_flood_maw", effect_into_the_flood_maw},
+    {"surgical_extraction", effect_surgical_extraction},
+    {"veil_of_summer", effect_veil_of_summer},
+};
+
+static void (*find_effect(const char *name))(GameState *, CardId)
 {
-    struct
+    for (size_t i = 0; i < sizeof(effects) / sizeof(effects[0]); ++i)
     {
-        const char *name;
-        int type;
-        int generic;
-        int red, blue, green;
-        void (*effect)(GameState *, int);
-    } defs[] = {
-        {"Artist's Talent", ENCHANTMENT, 1, 1, 0, 0, effect_artists_talent},
-        {"Bloodstained Mire", LAND, 0, 0, 0, 0, NULL},
-        {"Commercial District", LAND, 0, 0, 0, 0, NULL},
-        {"Desperate Ritual", SORCERY, 0, 0, 0, 0, effect_desperate_ritual},
-        {"Fiery Islet", LAND, 0, 0, 0, 0, NULL},
-        {"Flame of Anor", INSTANT, 1, 1, 1, 0, effect_flame_of_anor},
-        {"Grapeshot", SORCERY, 1, 1, 0, 0, effect_grapeshot},
-        {"Manamorphose", SORCERY, 1, 1, 0, 0, effect_manamorphose},
-        {"Mountain", LAND, 0, 0, 0, 0, NULL},
-        {"Past in Flames", SORCERY, 3, 1, 0, 0, effect_past_in_flames},
-        {"Pyretic Ritual", INSTANT, 1, 1, 0, 0, effect_pyretic_ritual},
-        {"Ral, Monsoon Mage", CREATURE, 1, 1, 0, 0, effect_ral},
-        {"Reckless Impulse", INSTANT, 1, 1, 0, 0, effect_reckless_impulse},
-        {"Ruby Medallion", ARTIFACT, 2, 0, 0, 0, effect_ruby_medallion},
-        {"Stomping Ground", LAND, 0, 0, 0, 0, NULL},
-        {"Stormcatch Mentor", CREATURE, 0, 1, 1, 0, effect_stormcatch_mentor},
-        {"Stormscale Scion", CREATURE, 4, 2, 0, 0, effect_stormscale_scion},
-        {"Thundering Falls", LAND, 0, 0, 0, 0, NULL},
-        {"Valakut Awakening", MDFC, 2, 1, 0, 0, effect_valakut_awakening},
-        {"Wish", SORCERY, 2, 1, 0, 0, effect_wish},
-        {"Wooded Foothills", LAND, 0, 0, 0, 0, NULL},
-        {"Wrenn's Resolve", SORCERY, 1, 1, 0, 0, effect_wrenn_resolve},
-        {"Blood Moon", ENCHANTMENT, 2, 1, 0, 0, effect_blood_moon},
-        {"Brotherhood's End", SORCERY, 2, 2, 0, 0, effect_brotherhoods_end},
-        {"Collective Resistance", INSTANT, 1, 0, 0, 1, effect_collective_resistance},
-        {"Escape to the Wilds", SORCERY, 3, 1, 0, 1, effect_escape_to_the_wilds},
-        {"Galvanic Relay", INSTANT, 1, 1, 0, 0, effect_galvanic_relay},
-        {"Into the Flood Maw", INSTANT, 0, 0, 1, 0, effect_into_the_flood_maw},
-        {"Surgical Extraction", INSTANT, 0, 0, 0, 0, effect_surgical_extraction},
-        {"Veil of Summer", INSTANT, 0, 0, 0, 1, effect_veil_of_summer},
-    };
+        if (strcmp(effects[i].name, name) == 0)
+            return effects[i].fn;
+    }
+    return NULL;
+}
 
-    const size_t defs_n = sizeof(defs) / sizeof(defs[0]);
-    memset(library, 0, sizeof(library));
-    for (size_t i = 0; i < defs_n && i < (sizeof(library) / sizeof(library[0])); ++i)
+int compile_cards(const char *src_path, const char *db_path)
+{
+    void *image;
+    size_t size;
+    if (carddb_compile(src_path, &image, &size) != 0)
     {
-        /* Make an owned copy of the name so we can adjust duplicates. */
-        char *namedup = xstrdup(defs[i].name);
+        fprintf(stderr, "failed to compile %s\n", src_path);
+        return -1;
+    }
+    int rc = carddb_write(db_path, image, size);
+    if (rc != 0)
+        fprintf(stderr, "failed to write %s\n", db_path);
+    free(image);
+    return rc;
+}
 
-        /* If the name already exists earlier in the table, append an index
-           to make it unique (e.g. "Grapeshot (2)"). Use the index i to
-           keep it deterministic. */
-        for (size_t j = 0; j < i; ++j)
+int init_cards(void)
+{
+    // the compiled database is mapped as-is; cards.txt is only parsed when
+    // it has not been compiled yet
+    if (carddb_open(&card_db, CARD_DB_PATH) != 0)
+    {
+        void *image;
+        size_t size;
+        if (carddb_compile(CARD_SOURCE_PATH, &image, &size) != 0 || carddb_attach(&card_db, image, size) != 0)
         {
-            if (strcmp(namedup, library[j].name) == 0)
-            {
-                char buf[256];
-                snprintf(buf, sizeof(buf), "%s (%zu)", defs[i].name, i);
-                free(namedup);
-                namedup = xstrdup(buf);
-                break;
-            }
+            fprintf(stderr, "failed to load the card database (%s or %s)\n", CARD_DB_PATH, CARD_SOURCE_PATH);
+            return -1;
         }
+    }
 
-        library[i].name = namedup;
-        library[i].type = defs[i].type;
-        library[i].cost_generic = defs[i].generic;
-        library[i].cost_color[0] = defs[i].red;
-        library[i].cost_color[1] = defs[i].blue;
-        library[i].cost_color[2] = defs[i].green;
-        library[i].effect = defs[i].effect;
-        library[i].power = 0;
-        library[i].toughness = 0;
-        library[i].affect = NULL;
+    library_count = (int)card_db.hdr->count;
+    memset(library, 0, sizeof(library));
+    for (int i = 0; i < library_count; ++i)
+    {
+        const CardDbRecord *r = &card_db.cards[i];
+        library[i].name = carddb_string(&card_db, r->name_off);
+        library[i].type = r->type;
+        library[i].supertype = r->supertype;
+        library[i].cost_generic = r->cost_generic;
+        library[i].cost_color[0] = r->cost_color[0];
+        library[i].cost_color[1] = r->cost_color[1];
+        library[i].cost_color[2] = r->cost_color[2];
+        library[i].power = r->power;
+        library[i].toughness = r->toughness;
+        library[i].produces = r->produces;
         library[i].activated_abilities = NULL;
-        library[i].tapped = 0;
+        if (r->effect_off)
+        {
+            const char *effect = carddb_string(&card_db, r->effect_off);
+            library[i].affect = find_effect(effect);
+            if (!library[i].affect)
+                fprintf(stderr, "%s: unknown effect \"%s\"\n", library[i].name, effect);
+        }
     }
+    return 0;
+}
+
+CardId find_card(const char *name)
+{
+    int id = carddb_lookup(&card_db, name);
+    return id < 0 ? NO_CARD : (CardId)id;
 }
@@ -3,13 +3,28 @@
 
 #include "vars.h"
 
-/* Number of templates in the library; keep in sync with cards.c */
-#define LIBRARY_SIZE 31
+/* Card definitions live in cards.txt, compiled into cards.db (see
+   carddb.h). Adding a card needs no C changes unless it has a new effect. */
+#define CARD_SOURCE_PATH "cards.txt"
+#define CARD_DB_PATH "cards.db"
 
-/* Library of card templates (defined in cards.c) */
-extern Card library[LIBRARY_SIZE];
+/* Card ids are below NO_CARD, so the library holds at most 255 cards */
+#define MAX_LIBRARY 255
 
-/* Initialize the library; must be called before using `library` */
-void init_cards(void);
+/* Library of card templates (defined in cards.c); library_count entries are
+   in use */
+extern Card library[MAX_LIBRARY];
+extern int library_count;
+
+/* Load the library from cards.db, or from cards.txt if it has not been
+   compiled. Must be called before using `library`; returns 0 on success. */
+int init_cards(void);
+
+/* Compile a cards.txt-style source into a binary database. Returns 0 on
+   success. */
+int compile_cards(const char *src_path, const char *db_path);
+
+/* Look up a card by exact name; returns NO_CARD if it is not in the library */
+CardId find_card(const char *name);
 
 #endif /* STORM_DECK_CARDS_H */
\ No newline at end of file
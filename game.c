@@ -0,0 +1,373 @@
+#include <stdlib.h>
+#include <string.h>
+#include "vars.h"
+#include "cards.h"
+#include "game.h"
+#include "rng.h"
+
+void init_game(GameState *gs, const Decklist *dl)
+{
+    memset(gs, 0, sizeof(*gs));
+    gs->player_life = STARTING_LIFE;
+    gs->opponent_life = OPPONENT_LIFE;
+    gs->library_count = (uint8_t)dl->main_count;
+    gs->library_hidden = gs->library_count;
+    // decklist order from the top down; cards[] holds the library bottom first
+    for (int i = 0; i < dl->main_count; ++i)
+        gs->cards[dl->main_count - 1 - i] = dl->main[i];
+}
+
+/* number of cards in all zones together, i.e. the used part of cards[] */
+static int card_total(const GameState *gs)
+{
+    return gs->library_count + gs->hand_count + gs->battlefield_count + gs->graveyard_count +
+           gs->exile_count;
+}
+
+/* Put `id` at cards[pos], moving the cards from there on up one slot. The
+   caller counts it into its zone. */
+static int insert_card(GameState *gs, int pos, CardId id)
+{
+    int total = card_total(gs);
+    if (id == NO_CARD || total >= DECK_SIZE)
+        return -1;
+    memmove(&gs->cards[pos + 1], &gs->cards[pos], (size_t)(total - pos));
+    gs->cards[pos] = id;
+    return 0;
+}
+
+/* Take cards[pos] out, moving the cards after it down one slot. Call before
+   uncounting it from its zone. */
+static CardId remove_card(GameState *gs, int pos)
+{
+    CardId id = gs->cards[pos];
+    memmove(&gs->cards[pos], &gs->cards[pos + 1], (size_t)(card_total(gs) - pos - 1));
+    return id;
+}
+
+/* cards[] slot of the card `i` places from the top of the library */
+static int library_slot(const GameState *gs, int i)
+{
+    return gs->library_count - 1 - i;
+}
+
+/* Settle the top card of the unshuffled part of the library: one lazy
+   Fisher-Yates step picks it from the cards nobody has looked at yet. The
+   step's counter is the number of such cards, which falls by one per step
+   (see shuffle_deck). */
+static void settle_next(GameState *gs)
+{
+    if (gs->shuffle_key)
+    {
+        int q = library_slot(gs, gs->library_known);
+        uint32_t h = gs->library_hidden;
+        int j = library_slot(gs, gs->library_known + (int)rng_below(gs->shuffle_key, h, h));
+        CardId tmp = gs->cards[q];
+        gs->cards[q] = gs->cards[j];
+        gs->cards[j] = tmp;
+    }
+    gs->library_known++;
+    gs->library_hidden--;
+}
+
+CardId peekLibrary(GameState *gs, int i)
+{
+    if (i < 0 || i >= gs->library_count)
+        return NO_CARD;
+    while (i >= gs->library_known && i < gs->library_known + gs->library_hidden)
+        settle_next(gs);
+    return gs->cards[library_slot(gs, i)];
+}
+
+CardId drawCard(GameState *gs)
+{
+    /* Skip over unknown decklist entries so they never reach a zone. */
+    while (gs->library_count > 0)
+    {
+        CardId id = peekLibrary(gs, 0);
+        remove_card(gs, library_slot(gs, 0));
+        gs->library_count--;
+        if (gs->library_known)
+            gs->library_known--;
+        if (id != NO_CARD)
+            return id;
+    }
+    return NO_CARD;
+}
+
+void putOnTop(GameState *gs, CardId id)
+{
+    if (insert_card(gs, gs->library_count, id) < 0)
+        return;
+    gs->library_count++;
+    gs->library_known++;
+}
+
+void putOnBottom(GameState *gs, CardId id)
+{
+    if (insert_card(gs, 0, id) < 0)
+        return;
+    gs->library_count++;
+}
+
+void scry(GameState *gs, int n, uint32_t bottom)
+{
+    CardId seen[32];
+    int count = 0;
+    if (n > 32)
+        n = 32;
+    while (count < n && gs->library_count > 0)
+        seen[count++] = drawCard(gs);
+    for (int i = count - 1; i >= 0; --i)
+    {
+        if (!(bottom & (1u << i)))
+            putOnTop(gs, seen[i]);
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        if (bottom & (1u << i))
+            putOnBottom(gs, seen[i]);
+    }
+}
+
+int addToHand(GameState *gs, CardId id)
+{
+    if (insert_card(gs, (int)(handCards(gs) - gs->cards) + gs->hand_count, id) < 0)
+        return -1;
+    gs->hand_count++;
+    return 0;
+}
+
+int addToBattlefield(GameState *gs, CardId id)
+{
+    if (insert_card(gs, (int)(battlefieldCards(gs) - gs->cards) + gs->battlefield_count, id) < 0)
+        return -1;
+    gs->battlefield_count++;
+    return 0;
+}
+
+int addToGraveyard(GameState *gs, CardId id)
+{
+    if (insert_card(gs, (int)(graveyardCards(gs) - gs->cards) + gs->graveyard_count, id) < 0)
+        return -1;
+    gs->graveyard_count++;
+    return 0;
+}
+
+int drawCardToHand(GameState *gs)
+{
+    CardId id = drawCard(gs);
+    if (id == NO_CARD)
+        return -1;
+    // a drawn card always fits; should it not, it stays on the library
+    if (addToHand(gs, id) < 0)
+    {
+        putOnTop(gs, id);
+        return -1;
+    }
+    return 0;
+}
+
+int exileTop(GameState *gs)
+{
+    CardId id = drawCard(gs);
+    if (id == NO_CARD)
+        return -1;
+    // the drawn card's slot is free, so this cannot fail
+    insert_card(gs, card_total(gs), id);
+    gs->exile_count++;
+    gs->impulse_count++;
+    return 0;
+}
+
+CardId removeFromHand(GameState *gs, int idx)
+{
+    if (idx < 0 || idx >= gs->hand_count)
+        return NO_CARD;
+    CardId id = remove_card(gs, (int)(handCards(gs) - gs->cards) + idx);
+    gs->hand_count--;
+    return id;
+}
+
+void damageOpponent(GameState *gs, int amount)
+{
+    int life = gs->opponent_life - amount;
+    if (life < INT8_MIN)
+        life = INT8_MIN;
+    gs->opponent_life = (int8_t)life;
+}
+
+CardId removeFromExile(GameState *gs, int idx)
+{
+    if (idx < 0 || idx >= gs->impulse_count)
+        return NO_CARD;
+    CardId id = remove_card(gs, (int)(impulseCards(gs) - gs->cards) + idx);
+    gs->exile_count--;
+    gs->impulse_count--;
+    return id;
+}
+
+void shuffle_deck(CardId deck[], int n, uint64_t key)
+{
+    for (int i = 0; i < n - 1; ++i)
+    {
+        int j = i + (int)rng_below(key, (uint32_t)(n - i), (uint32_t)(n - i));
+        CardId tmp = deck[i];
+        deck[i] = deck[j];
+        deck[j] = tmp;
+    }
+}
+
+void shuffle_library(GameState *gs, uint64_t key)
+{
+    gs->shuffle_key = key;
+    gs->library_known = 0;
+    gs->library_hidden = gs->library_count;
+}
+
+void beginTurn(GameState *gs)
+{
+    gs->turn++;
+    gs->tapped = 0;
+    gs->land_played = 0;
+    memset(gs->player_mana, 0, sizeof(gs->player_mana));
+    gs->storm_count = 0;
+    gs->impulse_count = 0;
+    if (gs->turn > 1)
+        drawCardToHand(gs);
+}
+
+int playLand(GameState *gs, int idx)
+{
+    if (idx < 0 || idx >= gs->hand_count || gs->land_played)
+        return -1;
+    if (library[handCards(gs)[idx]].type != LAND)
+        return -1;
+    if (addToBattlefield(gs, removeFromHand(gs, idx)) < 0)
+        return -1;
+    gs->land_played = 1;
+    return 0;
+}
+
+void tapAllLands(GameState *gs)
+{
+    const CardId *battlefield = battlefieldCards(gs);
+    for (int i = 0; i < gs->battlefield_count; ++i)
+    {
+        uint64_t bit = 1ULL << i;
+        if ((gs->tapped & bit) || library[battlefield[i]].type != LAND)
+            continue;
+        gs->tapped |= bit;
+        gs->player_mana[library[battlefield[i]].produces]++;
+    }
+}
+
+/* Exact affordability of `need` colored pips plus `generic` from a symbolic
+   pool (Hall's condition): for every set T of colors, the units that can be
+   spent as some color in T must cover T's pips, and the pool must cover the
+   whole cost. No color assignment is enumerated. */
+static int mana_feasible(const uint8_t *pool, const int need[3], int generic)
+{
+    int total = 0;
+    for (int m = 0; m < MANA_SLOTS; ++m)
+        total += pool[m];
+    if (total < need[RED] + need[BLUE] + need[GREEN] + generic)
+        return 0;
+    // common case: nothing but single-color and colorless units
+    if (!(pool[MANA_BIT(RED) | MANA_BIT(BLUE)] | pool[MANA_BIT(RED) | MANA_BIT(GREEN)] |
+          pool[MANA_BIT(BLUE) | MANA_BIT(GREEN)] | pool[MANA_ANY]))
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            if (pool[MANA_BIT(i)] < need[i])
+                return 0;
+        }
+        return 1;
+    }
+    // adding a color without pips to T only adds supply, so only subsets of
+    // the colors the cost actually needs have to be checked
+    int pips = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (need[i] > 0)
+            pips |= MANA_BIT(i);
+    }
+    for (int t = pips; t; t = (t - 1) & pips)
+    {
+        int demand = 0, supply = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            if (t & MANA_BIT(i))
+                demand += need[i];
+        }
+        for (int m = 1; m < MANA_SLOTS; ++m)
+        {
+            if (m & t)
+                supply += pool[m];
+        }
+        if (supply < demand)
+            return 0;
+    }
+    return 1;
+}
+
+/* Slots from least to most flexible: colorless, single colors (red last, it
+   is the deck's main color), two-color choices, then any color. */
+static const uint8_t pay_order[MANA_SLOTS] = {
+    MANA_COLORLESS,
+    MANA_BIT(GREEN), MANA_BIT(BLUE), MANA_BIT(RED),
+    MANA_BIT(BLUE) | MANA_BIT(GREEN), MANA_BIT(RED) | MANA_BIT(GREEN), MANA_BIT(RED) | MANA_BIT(BLUE),
+    MANA_ANY};
+
+int canCast(const GameState *gs, CardId id)
+{
+    const Card *c = &library[id];
+    return mana_feasible(gs->player_mana, c->cost_color, c->cost_generic);
+}
+
+int castCard(GameState *gs, CardId id)
+{
+    const Card *c = &library[id];
+    if (!canCast(gs, id))
+        return -1;
+
+    /* Colored pips first, each from the least flexible unit that keeps the
+       rest of the cost payable, then generic from the least flexible units.
+       This resolves the symbolic units to concrete colors. */
+    int need[3] = {c->cost_color[RED], c->cost_color[BLUE], c->cost_color[GREEN]};
+    uint8_t *pool = gs->player_mana;
+    for (int i = 0; i < 3; ++i)
+    {
+        while (need[i] > 0)
+        {
+            for (int k = 1; k < MANA_SLOTS; ++k)
+            {
+                int m = pay_order[k];
+                if (!(m & MANA_BIT(i)) || pool[m] == 0)
+                    continue;
+                pool[m]--;
+                need[i]--;
+                if (mana_feasible(pool, need, c->cost_generic))
+                    break;
+                pool[m]++;
+                need[i]++;
+            }
+        }
+    }
+    int generic = c->cost_generic;
+    for (int k = 0; k < MANA_SLOTS && generic > 0; ++k)
+    {
+        int m = pay_order[k];
+        int take = pool[m] < generic ? pool[m] : generic;
+        pool[m] -= (uint8_t)take;
+        generic -= take;
+    }
+
+    if (c->affect)
+        c->affect(gs, id);
+    gs->storm_count++;
+    // the card came out of a zone, so there is always room for it here
+    if (c->type == INSTANT || c->type == SORCERY || c->type == MDFC)
+        return addToGraveyard(gs, id);
+    return addToBattlefield(gs, id);
+}
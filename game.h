@@ -0,0 +1,109 @@
+#ifndef STORM_DECK_GAME_H
+#define STORM_DECK_GAME_H
+
+#include "vars.h"
+
+/* The zones are consecutive runs of GameState.cards; these point at the
+   first card of each. A pointer is only valid until the next card moves. */
+static inline CardId *handCards(GameState *gs)
+{
+    return gs->cards + gs->library_count;
+}
+static inline CardId *battlefieldCards(GameState *gs)
+{
+    return handCards(gs) + gs->hand_count;
+}
+static inline CardId *graveyardCards(GameState *gs)
+{
+    return battlefieldCards(gs) + gs->battlefield_count;
+}
+static inline CardId *exileCards(GameState *gs)
+{
+    return graveyardCards(gs) + gs->graveyard_count;
+}
+static inline CardId *impulseCards(GameState *gs)
+{
+    return exileCards(gs) + gs->exile_count - gs->impulse_count;
+}
+
+/* Reset `gs` to a fresh game with `dl`'s main deck as the (unshuffled)
+   library. */
+void init_game(GameState *gs, const Decklist *dl);
+
+/* Take the top card of the library; returns NO_CARD when it is empty. */
+CardId drawCard(GameState *gs);
+
+/* Card `i` places from the top of the library (0 = top) without removing
+   it; NO_CARD past the bottom. Fixes the card's place in a lazy shuffle. */
+CardId peekLibrary(GameState *gs, int i);
+
+/* Put a card on top of / under the library. Dropped if the state already
+   holds DECK_SIZE cards. */
+void putOnTop(GameState *gs, CardId id);
+void putOnBottom(GameState *gs, CardId id);
+
+/* Scry `n` (at most 32): look at the top n cards, put those whose bit is set in
+   `bottom` (bit 0 = top card) on the bottom in that order, and leave the
+   rest on top in their order. */
+void scry(GameState *gs, int n, uint32_t bottom);
+
+/* Draw the top card of the library into the hand. Returns 0, or -1 if
+   nothing was drawn (the library is empty). */
+int drawCardToHand(GameState *gs);
+
+/* Exile the top card of the library (impulse-style draw); it may be played
+   until the end of the turn. Returns 0, or -1 if the library is empty. */
+int exileTop(GameState *gs);
+
+/* Zone helpers: put a card that is in no zone (just removed from one, or
+   from outside the game) last in a zone. Return 0, or -1 for NO_CARD or if
+   the state already holds DECK_SIZE cards; a card removed from a zone
+   always fits. */
+int addToHand(GameState *gs, CardId id);
+int addToBattlefield(GameState *gs, CardId id);
+int addToGraveyard(GameState *gs, CardId id);
+
+/* Remove and return the card at hand index `idx`, keeping the remaining
+   hand contiguous. */
+CardId removeFromHand(GameState *gs, int idx);
+
+/* Remove and return the card at index `idx` of this turn's impulse cards
+   (see impulseCards). */
+CardId removeFromExile(GameState *gs, int idx);
+
+/* Fisher-Yates shuffle of the first `n` entries of `deck` with rng key
+   `key` (see rng.h). Gives the same order as shuffle_library. */
+void shuffle_deck(CardId deck[], int n, uint64_t key);
+
+/* Shuffle the library with rng key `key`, lazily: each card is picked at
+   random from the cards nobody has looked at yet when it is first drawn or
+   peeked at, so a game pays only for the cards it sees. Shuffling again
+   needs a new key. */
+void shuffle_library(GameState *gs, uint64_t key);
+
+/* Start the next turn: untap, empty the mana pool, reset storm and the
+   land drop, leave last turn's impulse cards in exile unplayable and draw (except on turn 1,
+   since we are on the play). */
+void beginTurn(GameState *gs);
+
+/* Play the land at hand index `idx`. Returns 0 on success, -1 if it is not
+   a land, a land was already played this turn or it could not be put onto
+   the battlefield. */
+int playLand(GameState *gs, int idx);
+
+/* Tap every untapped land on the battlefield for mana. */
+void tapAllLands(GameState *gs);
+
+/* Non-zero when the mana pool can pay for card `id`. */
+int canCast(const GameState *gs, CardId id);
+
+/* Pay for and resolve card `id`, which the caller has already removed from
+   its zone, then put it into the graveyard (instants, sorceries and MDFCs)
+   or onto the battlefield. Returns 0 on success, -1 if the cost cannot be
+   paid or the card could not be put into its zone. */
+int castCard(GameState *gs, CardId id);
+
+/* Deal `amount` to the opponent, saturating at the int8 range. */
+void damageOpponent(GameState *gs, int amount);
+
+#endif /* STORM_DECK_GAME_H */
@@ -3,23 +3,31 @@
 #include <time.h>
 #include "vars.h"
 #include "cards.h"
+#include "game.h"
+#include "sim.h"
+#include "optimize.h"
+#include "rng.h"
+#include "mulligan.h"
+#include "metrics.h"
 
-static void init_deck(int deck[], int n, int sideboard[], int m)
-{
-    // Initialize card library (populates library[] defined in cards.h)
-    init_cards();
+#define DECKLIST_PATH "decklist.txt"
 
+// random hands per mulligan depth used to set the keep thresholds
+#define MULLIGAN_SAMPLES 200
+
+static void init_deck(Decklist *dl, const char *path)
+{
     // Open decklist file and parse lines of the form:
     // <count> <card name>
     // followed by a line containing "SIDEBOARD:" and then sideboard entries
-    FILE *f = fopen("decklist.txt", "r");
+    FILE *f = fopen(path, "r");
     if (!f)
     {
-        // fallback: fill with a simple sequence if file not found
-        for (int i = 0; i < n; ++i)
-            deck[i] = i;
-        for (int i = 0; i < m; ++i)
-            sideboard[i] = -1;
+        // fallback: cycle through the library if file not found
+        for (int i = 0; i < DECK_SIZE; ++i)
+            dl->main[i] = (CardId)(i % library_count);
+        dl->main_count = DECK_SIZE;
+        dl->side_count = 0;
         return;
     }
 
@@ -27,7 +35,6 @@ static void init_deck(int deck[], int n, int sideboard[], int m)
     int side_pos = 0;
     char line[512];
     int in_sideboard = 0;
-    size_t pool_size = sizeof(library) / sizeof(library[0]);
 
     while (fgets(line, sizeof(line), f))
     {
@@ -68,91 +75,181 @@ static void init_deck(int deck[], int n, int sideboard[], int m)
         }
 
         // p now points at card name
+        CardId found = find_card(p);
         for (long k = 0; k < cnt; ++k)
         {
-            // find card in library by name (string compare)
-            int found = -1;
-            for (size_t i = 0; i < pool_size; ++i)
-            {
-                const char *name = library[i].name;
-                if (!name)
-                    continue;
-                if (strcmp(name, p) == 0)
-                {
-                    found = (int)i;
-                    break;
-                }
-            }
-
             if (in_sideboard)
             {
-                if (side_pos < m)
-                    sideboard[side_pos++] = found;
+                if (side_pos < SIDEBOARD_SIZE)
+                    dl->side[side_pos++] = found;
             }
             else
             {
-                if (deck_pos < n)
-                    deck[deck_pos++] = found;
+                if (deck_pos < DECK_SIZE)
+                    dl->main[deck_pos++] = found;
             }
         }
     }
 
     fclose(f);
 
-    // if deck or sideboard not fully populated, fill remaining slots with -1
-    for (int i = deck_pos; i < n; ++i)
-        deck[i] = -1;
-    for (int i = side_pos; i < m; ++i)
-        sideboard[i] = -1;
+    dl->main_count = deck_pos;
+    dl->side_count = side_pos;
 }
 
-static void shuffle_deck(int deck[], int n)
+static void usage(const char *prog)
 {
-    for (int i = n - 1; i > 0; --i)
-    {
-        int j = rand() % (i + 1);
-        int tmp = deck[i];
-        deck[i] = deck[j];
-        deck[j] = tmp;
-    }
+    fprintf(stderr, "usage: %s [--simulate GAMES] [--turns N] [--seed S] [--threads N]\n"
+                    "          [--mulligan [--rollouts R] [--target win|damage]]\n", prog);
+    fprintf(stderr, "       %s [--simulate MAX_GAMES] --half-width H [--confidence C] [--compare DECKLIST]\n", prog);
+    fprintf(stderr, "       %s --optimize STEPS [--simulate GAMES] [--turns N] [--seed S]\n"
+                    "          [--temp T] [--lands MIN:MAX] [--target win|damage]\n", prog);
+    fprintf(stderr, "       any of the above with [--metrics SEC] [--metrics-json FILE]\n");
+    fprintf(stderr, "       %s --compile-cards SRC DB\n", prog);
 }
 
-static Card drawCard(int deck[])
+int main(int argc, char **argv)
 {
-    /* Find the first non-empty slot (non -1), remove it from the deck
-       so it can't be drawn again, and return the corresponding card. */
-    Card empty = {0};
-    for (int i = 0; i < DECK_SIZE; ++i)
+    long games = 0;
+    int max_turns = 6;
+    unsigned seed = (unsigned)time(NULL);
+    int threads = 1;
+    int mulligan = 0;
+    int rollouts = 32;
+    int optimize_steps = 0;
+    double temperature = 0.0;
+    int min_lands = -1, max_lands = -1;
+    int target = SIM_TARGET_WIN;
+    SimStop stop = {0.0, 0.95, 10000, 0};
+    const char *compare_path = NULL;
+    int metrics_every = 10;
+    const char *metrics_path = NULL;
+
+    for (int i = 1; i < argc; ++i)
     {
-        int idx = deck[i];
-        if (idx >= 0)
+        if (strcmp(argv[i], "--simulate") == 0 && i + 1 < argc)
+            games = strtol(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--turns") == 0 && i + 1 < argc)
+            max_turns = (int)strtol(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = (unsigned)strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = (int)strtol(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--mulligan") == 0)
+            mulligan = 1;
+        else if (strcmp(argv[i], "--rollouts") == 0 && i + 1 < argc)
+            rollouts = (int)strtol(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--optimize") == 0 && i + 1 < argc)
+            optimize_steps = (int)strtol(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--temp") == 0 && i + 1 < argc)
+            temperature = strtod(argv[++i], NULL);
+        else if (strcmp(argv[i], "--lands") == 0 && i + 1 < argc &&
+                 sscanf(argv[i + 1], "%d:%d", &min_lands, &max_lands) == 2)
+            ++i;
+        else if (strcmp(argv[i], "--target") == 0 && i + 1 < argc &&
+                 (strcmp(argv[i + 1], "win") == 0 || strcmp(argv[i + 1], "damage") == 0))
+            target = strcmp(argv[++i], "win") == 0 ? SIM_TARGET_WIN : SIM_TARGET_DAMAGE;
+        else if (strcmp(argv[i], "--half-width") == 0 && i + 1 < argc)
+            stop.half_width = strtod(argv[++i], NULL);
+        else if (strcmp(argv[i], "--confidence") == 0 && i + 1 < argc)
+            stop.confidence = strtod(argv[++i], NULL);
+        else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc)
+            compare_path = argv[++i];
+        else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+            metrics_every = (int)strtol(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--metrics-json") == 0 && i + 1 < argc)
+            metrics_path = argv[++i];
+        else if (strcmp(argv[i], "--compile-cards") == 0 && i + 2 < argc)
+            return compile_cards(argv[i + 1], argv[i + 2]) == 0 ? 0 : 1;
+        else
         {
-            deck[i] = -1; /* mark as drawn */
-            return library[idx];
+            usage(argv[0]);
+            return 1;
         }
     }
-    /* deck empty -> return zeroed sentinel */
-    return empty;
-}
 
-int main(void)
-{
-    GameState gs;
-    init_deck(gs.deck, DECK_SIZE, gs.sideboard, SIDEBOARD_SIZE);
-    gs.player_life = STARTING_LIFE;
-    gs.opponent_life = OPPONENT_LIFE;
-    gs.storm_count = 0;
-    gs.turn = 0;
+    // Initialize card library (populates library[] defined in cards.h)
+    if (init_cards() != 0)
+        return 1;
+    Decklist dl;
+    init_deck(&dl, DECKLIST_PATH);
 
-    srand((unsigned)time(NULL));
-    shuffle_deck(gs.deck, DECK_SIZE);
+    if (stop.half_width > 0.0 || compare_path)
+    {
+        if (stop.confidence <= 0.0 || stop.confidence >= 1.0)
+        {
+            fprintf(stderr, "--confidence must be between 0 and 1\n");
+            return 1;
+        }
+        // --simulate caps the games per deck in sequential mode
+        stop.max_games = games > 0 ? games : 10000000;
+        SimResult r, r_other;
+        Decklist other;
+        if (compare_path)
+            init_deck(&other, compare_path);
+        metrics_start(metrics_every, stop.max_games * (compare_path ? 2 : 1), NULL);
+        run_sequential(&dl, compare_path ? &other : NULL, max_turns, seed, threads, &stop, &r, &r_other);
+        int rc = metrics_stop(metrics_path) == 0 ? 0 : 1;
+        print_sim_result(&r);
+        if (compare_path)
+            print_sim_result(&r_other);
+        return rc;
+    }
 
-    printf("Drawn %d cards:\n", HAND_SIZE);
-    for (int i = 0; i < HAND_SIZE + 1; ++i)
+    if (optimize_steps > 0)
     {
-        gs.hand[i] = drawCard(gs.deck);
-        printf("%2d:%s\n", i + 1, gs.hand[i].name);
+        // common random numbers: every candidate deck plays the same shuffles
+        OptimizeConfig cfg = {games > 0 ? games : 10000, max_turns, target, seed, optimize_steps, temperature,
+                              min_lands, max_lands};
+        if (min_lands < 0)
+        {
+            int lands = 0;
+            for (int i = 0; i < dl.main_count; ++i)
+                lands += dl.main[i] != NO_CARD && library[dl.main[i]].type == LAND;
+            cfg.min_lands = lands - 2;
+            cfg.max_lands = lands + 2;
+        }
+        // replays vary per step, so the number of games is not known up front
+        metrics_start(metrics_every, 0, NULL);
+        int rc = optimize_deck(&dl, &cfg) == 0 ? 0 : 1;
+        if (metrics_stop(metrics_path) != 0)
+            rc = 1;
+        return rc;
     }
 
+    if (games > 0)
+    {
+        // Monte Carlo goldfish mode: the library and decklist above are
+        // built once and shared by every game.
+        SimResult r;
+        MulliganPolicy policy;
+        if (mulligan && mulligan_policy_init(&policy, &dl, max_turns, target, rollouts, MULLIGAN_SAMPLES, seed) != 0)
+        {
+            fprintf(stderr, "out of memory for the mulligan policy\n");
+            return 1;
+        }
+        metrics_start(metrics_every, games, mulligan ? &policy : NULL);
+        run_simulation(&dl, mulligan ? &policy : NULL, games, max_turns, seed, threads, &r);
+        int rc = metrics_stop(metrics_path) == 0 ? 0 : 1;
+        print_sim_result(&r);
+        if (mulligan)
+        {
+            print_mulligan_policy(&policy);
+            mulligan_policy_free(&policy);
+        }
+        return rc;
+    }
+
+    GameState gs;
+    init_game(&gs, &dl);
+    shuffle_library(&gs, rng_stream_key(seed, 0));
+
+    for (int i = 0; i < HAND_SIZE; ++i)
+        drawCardToHand(&gs);
+
+    printf("Drawn %d cards:\n", gs.hand_count);
+    for (int i = 0; i < gs.hand_count; ++i)
+        printf("%2d:%s\n", i + 1, library[handCards(&gs)[i]].name);
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,192 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "metrics.h"
+#include "mulligan.h"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+SimMetrics thread_metrics[MAX_SIM_THREADS];
+
+static struct
+{
+    int interval;
+    long games_total;
+    MulliganPolicy *policy;
+    struct timespec start;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cv;
+    int running;
+    int stop;
+} monitor = {.lock = PTHREAD_MUTEX_INITIALIZER, .cv = PTHREAD_COND_INITIALIZER};
+
+static void read_rss(MetricsSnapshot *s)
+{
+#ifdef __linux__
+    /* resident pages are the second field */
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f)
+    {
+        long size, resident;
+        if (fscanf(f, "%ld %ld", &size, &resident) == 2)
+            s->rss_bytes = resident * sysconf(_SC_PAGESIZE);
+        fclose(f);
+    }
+#endif
+#ifndef _WIN32
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0)
+    {
+#ifdef __APPLE__
+        s->peak_rss_bytes = ru.ru_maxrss; // bytes on macOS
+#else
+        s->peak_rss_bytes = ru.ru_maxrss * 1024L; // kilobytes elsewhere
+#endif
+    }
+#endif
+}
+
+void metrics_snapshot(MetricsSnapshot *s)
+{
+    memset(s, 0, sizeof(*s));
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    s->seconds = (double)(now.tv_sec - monitor.start.tv_sec) + (double)(now.tv_nsec - monitor.start.tv_nsec) * 1e-9;
+    for (int i = 0; i < MAX_SIM_THREADS; ++i)
+    {
+        s->games += atomic_load_explicit(&thread_metrics[i].games, memory_order_relaxed);
+        s->wins += atomic_load_explicit(&thread_metrics[i].wins, memory_order_relaxed);
+        s->turns += atomic_load_explicit(&thread_metrics[i].turns, memory_order_relaxed);
+    }
+    s->games_total = monitor.games_total;
+    if (monitor.policy)
+    {
+        pthread_mutex_lock(&monitor.policy->lock);
+        s->policy_lookups = monitor.policy->lookups;
+        s->policy_misses = monitor.policy->misses;
+        s->policy_entries = (long)monitor.policy->used;
+        s->policy_capacity = (long)monitor.policy->cap;
+        pthread_mutex_unlock(&monitor.policy->lock);
+    }
+    read_rss(s);
+}
+
+/* rates are measured since `prev` (NULL: since the start) */
+static void print_line(const MetricsSnapshot *s, const MetricsSnapshot *prev)
+{
+    double dt = prev ? s->seconds - prev->seconds : s->seconds;
+    uint64_t dg = prev ? s->games - prev->games : s->games;
+    uint64_t dturns = prev ? s->turns - prev->turns : s->turns;
+    fprintf(stderr, "[%.0fs] games %llu", s->seconds, (unsigned long long)s->games);
+    if (s->games_total > 0)
+        fprintf(stderr, "/%ld", s->games_total);
+    fprintf(stderr, " (%.0f/s, %.0f turns/s)  wins %llu", dt > 0.0 ? (double)dg / dt : 0.0,
+            dt > 0.0 ? (double)dturns / dt : 0.0, (unsigned long long)s->wins);
+    if (s->policy_lookups > 0)
+        fprintf(stderr, "  policy hit %.1f%% (%ld/%ld entries)",
+                100.0 * (double)(s->policy_lookups - s->policy_misses) / (double)s->policy_lookups,
+                s->policy_entries, s->policy_capacity);
+    fprintf(stderr, "  rss %.1f MB\n", (double)s->rss_bytes / (1024.0 * 1024.0));
+}
+
+static void *monitor_main(void *arg)
+{
+    (void)arg;
+    MetricsSnapshot prev;
+    metrics_snapshot(&prev);
+    pthread_mutex_lock(&monitor.lock);
+    while (!monitor.stop)
+    {
+        struct timespec wake;
+        timespec_get(&wake, TIME_UTC);
+        wake.tv_sec += monitor.interval;
+        while (!monitor.stop && pthread_cond_timedwait(&monitor.cv, &monitor.lock, &wake) == 0)
+            ;
+        if (monitor.stop)
+            break;
+        MetricsSnapshot cur;
+        metrics_snapshot(&cur);
+        print_line(&cur, &prev);
+        prev = cur;
+    }
+    pthread_mutex_unlock(&monitor.lock);
+    return NULL;
+}
+
+int metrics_start(int interval, long games_total, MulliganPolicy *policy)
+{
+    monitor.interval = interval;
+    monitor.games_total = games_total;
+    monitor.policy = policy;
+    monitor.stop = 0;
+    timespec_get(&monitor.start, TIME_UTC);
+    if (interval <= 0)
+        return 0;
+    if (pthread_create(&monitor.thread, NULL, monitor_main, NULL) != 0)
+    {
+        fprintf(stderr, "failed to start metrics thread\n");
+        return -1;
+    }
+    monitor.running = 1;
+    return 0;
+}
+
+static int write_json(const char *path, const MetricsSnapshot *s)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        fprintf(stderr, "cannot write metrics %s\n", path);
+        return -1;
+    }
+    fprintf(f,
+            "{\n"
+            "  \"seconds\": %.3f,\n"
+            "  \"games\": %llu,\n"
+            "  \"games_total\": %ld,\n"
+            "  \"games_per_second\": %.1f,\n"
+            "  \"wins\": %llu,\n"
+            "  \"turns\": %llu,\n"
+            "  \"policy_lookups\": %ld,\n"
+            "  \"policy_misses\": %ld,\n"
+            "  \"policy_entries\": %ld,\n"
+            "  \"policy_capacity\": %ld,\n"
+            "  \"rss_bytes\": %ld,\n"
+            "  \"peak_rss_bytes\": %ld\n"
+            "}\n",
+            s->seconds, (unsigned long long)s->games, s->games_total,
+            s->seconds > 0.0 ? (double)s->games / s->seconds : 0.0, (unsigned long long)s->wins,
+            (unsigned long long)s->turns, s->policy_lookups, s->policy_misses, s->policy_entries, s->policy_capacity,
+            s->rss_bytes, s->peak_rss_bytes);
+    if (fclose(f) != 0)
+    {
+        fprintf(stderr, "error writing metrics %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+int metrics_stop(const char *json_path)
+{
+    if (monitor.running)
+    {
+        pthread_mutex_lock(&monitor.lock);
+        monitor.stop = 1;
+        pthread_cond_signal(&monitor.cv);
+        pthread_mutex_unlock(&monitor.lock);
+        pthread_join(monitor.thread, NULL);
+        monitor.running = 0;
+    }
+    MetricsSnapshot s;
+    metrics_snapshot(&s);
+    if (monitor.interval > 0)
+        print_line(&s, NULL);
+    return json_path ? write_json(json_path, &s) : 0;
+}
@@ -0,0 +1,57 @@
+#ifndef STORM_DECK_METRICS_H
+#define STORM_DECK_METRICS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "sim.h"
+
+/* Live counters for simulator runs.
+
+   Each simulation thread owns one SimMetrics block (indexed like the
+   thread's range of games) and is its only writer, so an update is a
+   relaxed load and store instead of a locked add. A reader sums the blocks
+   whenever it wants a total. Blocks are cache-line aligned so threads do
+   not share lines. The counters accumulate over the whole process. */
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t games;
+    _Atomic uint64_t wins;
+    _Atomic uint64_t turns; // turns played, over all games
+} SimMetrics;
+
+extern SimMetrics thread_metrics[MAX_SIM_THREADS];
+
+static inline void metric_add(_Atomic uint64_t *c, uint64_t n)
+{
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+/* A merged view of the run at one moment */
+typedef struct
+{
+    double seconds; // since metrics_start
+    uint64_t games;
+    uint64_t wins;
+    uint64_t turns;
+    long games_total;     // games planned (an upper bound), 0 if unknown
+    long policy_lookups;  // mulligan policy cache, when one is used
+    long policy_misses;
+    long policy_entries;
+    long policy_capacity;
+    long rss_bytes;       // 0 where the platform does not report it
+    long peak_rss_bytes;
+} MetricsSnapshot;
+
+/* Start a thread that prints a progress line to stderr every `interval`
+   seconds (0: none). `games_total` and `policy` (may be NULL) only feed
+   the report. Returns 0 on success. */
+int metrics_start(int interval, long games_total, MulliganPolicy *policy);
+
+/* Stop the thread, print a final line if it was running and, if
+   `json_path` is not NULL, write the final counters there as JSON.
+   Returns 0 on success. */
+int metrics_stop(const char *json_path);
+
+void metrics_snapshot(MetricsSnapshot *s);
+
+#endif /* STORM_DECK_METRICS_H */
@@ -0,0 +1,291 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vars.h"
+#include "game.h"
+#include "rng.h"
+#include "sim.h"
+#include "mulligan.h"
+
+#define POLICY_INITIAL_CAP 4096
+
+_Static_assert(HAND_SIZE <= 7, "hand_key packs a hand into 56 bits");
+
+/* Copy `hand` into `sorted` in id order */
+static void sort_hand(CardId *sorted, const CardId *hand, int n)
+{
+    memcpy(sorted, hand, (size_t)n);
+    for (int i = 1; i < n; ++i)
+    {
+        CardId id = sorted[i];
+        int j = i;
+        while (j > 0 && sorted[j - 1] > id)
+        {
+            sorted[j] = sorted[j - 1];
+            --j;
+        }
+        sorted[j] = id;
+    }
+}
+
+/* Exact key of a sorted hand: its ids, 8 bits each, with the card count in
+   the top byte so the key is never 0. */
+static uint64_t hand_key(const CardId *sorted, int n)
+{
+    uint64_t key = (uint64_t)n << 56;
+    for (int i = 0; i < n; ++i)
+        key |= (uint64_t)sorted[i] << (8 * i);
+    return key;
+}
+
+static size_t slot_of(uint64_t key, size_t cap)
+{
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (cap - 1);
+}
+
+static int cache_find(const MulliganPolicy *p, uint64_t key, float *value)
+{
+    for (size_t i = slot_of(key, p->cap);; i = (i + 1) & (p->cap - 1))
+    {
+        if (p->keys[i] == key)
+        {
+            *value = p->values[i];
+            return 1;
+        }
+        if (p->keys[i] == 0)
+            return 0;
+    }
+}
+
+/* Insert or overwrite; doubles the table at half load. A failed grow only
+   means the value is not cached. */
+static void cache_insert(MulliganPolicy *p, uint64_t key, float value)
+{
+    if (2 * (p->used + 1) > p->cap)
+    {
+        size_t cap = 2 * p->cap;
+        uint64_t *keys = calloc(cap, sizeof(*keys));
+        float *values = malloc(cap * sizeof(*values));
+        if (!keys || !values)
+        {
+            free(keys);
+            free(values);
+            return;
+        }
+        for (size_t i = 0; i < p->cap; ++i)
+        {
+            if (!p->keys[i])
+                continue;
+            size_t j = slot_of(p->keys[i], cap);
+            while (keys[j])
+                j = (j + 1) & (cap - 1);
+            keys[j] = p->keys[i];
+            values[j] = p->values[i];
+        }
+        free(p->keys);
+        free(p->values);
+        p->keys = keys;
+        p->values = values;
+        p->cap = cap;
+    }
+    size_t i = slot_of(key, p->cap);
+    while (p->keys[i] && p->keys[i] != key)
+        i = (i + 1) & (p->cap - 1);
+    if (!p->keys[i])
+        p->used++;
+    p->keys[i] = key;
+    p->values[i] = value;
+}
+
+/* Mean score of `rollouts` games from `hand`, the rest of the deck shuffled
+   with keys from `seed` */
+static double rollout_value(const MulliganPolicy *p, const CardId *hand, int n, uint64_t seed)
+{
+    Decklist rest = *p->dl;
+    for (int i = 0; i < n; ++i)
+    {
+        for (int j = 0; j < rest.main_count; ++j)
+        {
+            if (rest.main[j] == hand[i])
+            {
+                rest.main[j] = rest.main[--rest.main_count];
+                break;
+            }
+        }
+    }
+
+    double sum = 0.0;
+    for (int r = 0; r < p->rollouts; ++r)
+    {
+        GameState gs;
+        init_game(&gs, &rest);
+        shuffle_library(&gs, rng_stream_key(seed, (uint64_t)r));
+        for (int i = 0; i < n; ++i)
+            addToHand(&gs, hand[i]);
+        int kill = play_from_hand(&gs, p->max_turns);
+        if (p->target == SIM_TARGET_WIN)
+            sum += kill > 0;
+        else
+            sum += OPPONENT_LIFE - (gs.opponent_life > 0 ? gs.opponent_life : 0);
+    }
+    return sum / p->rollouts;
+}
+
+/* Cached value of keeping `hand`. Rollouts start from the hand in id order
+   (the goldfish breaks ties by hand position) and values are rounded to
+   float whether or not they were cached, so a hand's value does not depend
+   on which thread or order of cards got to it first. */
+static double hand_value(MulliganPolicy *p, const CardId *hand, int n)
+{
+    CardId sorted[HAND_SIZE];
+    sort_hand(sorted, hand, n);
+    uint64_t key = hand_key(sorted, n);
+    float value;
+    pthread_mutex_lock(&p->lock);
+    p->lookups++;
+    int hit = cache_find(p, key, &value);
+    if (!hit)
+        p->misses++;
+    pthread_mutex_unlock(&p->lock);
+    if (hit)
+        return value;
+
+    value = (float)rollout_value(p, sorted, n, p->seed);
+    pthread_mutex_lock(&p->lock);
+    cache_insert(p, key, value);
+    pthread_mutex_unlock(&p->lock);
+    return value;
+}
+
+/* Value of the best hand left by bottoming `bottom` of the `n` cards in
+   `hand`; sets *mask to the hand indices to bottom. */
+static double best_keep(MulliganPolicy *p, const CardId *hand, int n, int bottom, unsigned *mask)
+{
+    if (bottom > n)
+        bottom = n;
+    double best = -1.0;
+    *mask = 0;
+    for (unsigned m = 0; m < (1u << n); ++m)
+    {
+        CardId kept[HAND_SIZE];
+        int k = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            if (!(m & (1u << i)))
+                kept[k++] = hand[i];
+        }
+        if (n - k != bottom)
+            continue;
+        double v = hand_value(p, kept, k);
+        if (v > best)
+        {
+            best = v;
+            *mask = m;
+        }
+    }
+    return best;
+}
+
+int mulligan_policy_init(MulliganPolicy *p, const Decklist *dl, int max_turns, int target, int rollouts,
+                         int samples, uint64_t seed)
+{
+    memset(p, 0, sizeof(*p));
+    p->dl = dl;
+    p->max_turns = max_turns > MAX_SIM_TURNS ? MAX_SIM_TURNS : max_turns;
+    p->target = target;
+    p->rollouts = rollouts > 0 ? rollouts : 1;
+    // streams at the top of the range, which no game index reaches
+    p->seed = rng_stream_key(seed, UINT64_MAX);
+    p->cap = POLICY_INITIAL_CAP;
+    p->keys = calloc(p->cap, sizeof(*p->keys));
+    p->values = malloc(p->cap * sizeof(*p->values));
+    if (!p->keys || !p->values)
+    {
+        mulligan_policy_free(p);
+        return -1;
+    }
+    pthread_mutex_init(&p->lock, NULL);
+    sim_init();
+
+    /* v[m] from the deepest mulligan up, every depth on the same sample
+       hands. The best of several noisy hand values overstates the hand it
+       picks, which would make deep mulligans look good, so the picked hand
+       is valued again on independent rollouts. */
+    uint64_t sample_seed = rng_stream_key(seed, UINT64_MAX - 1);
+    uint64_t check_seed = rng_stream_key(seed, UINT64_MAX - 2);
+    for (int m = MAX_MULLIGANS; m >= 0; --m)
+    {
+        double sum = 0.0;
+        for (int i = 0; i < samples; ++i)
+        {
+            GameState gs;
+            init_game(&gs, dl);
+            shuffle_library(&gs, rng_stream_key(sample_seed, (uint64_t)i));
+            for (int c = 0; c < HAND_SIZE; ++c)
+                drawCardToHand(&gs);
+            unsigned mask;
+            double v = best_keep(p, handCards(&gs), gs.hand_count, m, &mask);
+            if (m < MAX_MULLIGANS && v < p->continue_value[m + 1])
+            {
+                sum += p->continue_value[m + 1];
+                continue;
+            }
+            CardId kept[HAND_SIZE], sorted[HAND_SIZE];
+            int k = 0;
+            for (int c = 0; c < gs.hand_count; ++c)
+            {
+                if (!(mask & (1u << c)))
+                    kept[k++] = handCards(&gs)[c];
+            }
+            sort_hand(sorted, kept, k);
+            sum += rollout_value(p, sorted, k, check_seed);
+        }
+        p->continue_value[m] = samples > 0 ? sum / samples : 0.0;
+    }
+    return 0;
+}
+
+void mulligan_policy_free(MulliganPolicy *p)
+{
+    if (p->keys)
+        pthread_mutex_destroy(&p->lock);
+    free(p->keys);
+    free(p->values);
+    p->keys = NULL;
+    p->values = NULL;
+}
+
+int london_mulligan(GameState *gs, MulliganPolicy *p, uint64_t key)
+{
+    for (int m = 0;; ++m)
+    {
+        for (int i = 0; i < HAND_SIZE; ++i)
+            drawCardToHand(gs);
+        unsigned mask;
+        double v = best_keep(p, handCards(gs), gs->hand_count, m, &mask);
+        if (m == MAX_MULLIGANS || v >= p->continue_value[m + 1])
+        {
+            // from the back, so removing a card leaves lower indices alone
+            for (int i = gs->hand_count - 1; i >= 0; --i)
+            {
+                if (mask & (1u << i))
+                    putOnBottom(gs, removeFromHand(gs, i));
+            }
+            return m;
+        }
+        while (gs->hand_count > 0)
+            putOnBottom(gs, removeFromHand(gs, gs->hand_count - 1));
+        shuffle_library(gs, rng_stream_key(key, (uint64_t)m + 1));
+    }
+}
+
+void print_mulligan_policy(const MulliganPolicy *p)
+{
+    printf("Mulligan policy (%s, %d rollouts per hand):\n",
+           p->target == SIM_TARGET_WIN ? "win rate" : "mean damage", p->rollouts);
+    for (int m = 1; m <= MAX_MULLIGANS; ++m)
+        printf("  keep %d cards if worth at least %.4f\n", HAND_SIZE - (m - 1), p->continue_value[m]);
+    printf("  expected value %.4f\n", p->continue_value[0]);
+    printf("  %zu hands cached, %ld lookups, %.1f%% hits\n", p->used, p->lookups,
+           p->lookups ? 100.0 * (double)(p->lookups - p->misses) / (double)p->lookups : 0.0);
+}
@@ -0,0 +1,59 @@
+#ifndef STORM_DECK_MULLIGAN_H
+#define STORM_DECK_MULLIGAN_H
+
+#include <pthread.h>
+#include "vars.h"
+#include "sim.h"
+
+/* London mulligan policy.
+
+   A kept hand is valued by playing `rollouts` goldfish games from it with
+   the rest of the deck shuffled, on the same rollout shuffles for every
+   hand, and scored like the optimizer (SIM_TARGET_WIN or _DAMAGE). Values
+   are cached by hand multiset, so each distinct hand is rolled out once per
+   run and every later decision on it is a table lookup.
+
+   After m mulligans the best m cards to bottom are the ones that leave the
+   most valuable hand. The hand is kept when that value is at least v[m+1],
+   the expected value of mulliganing again under the same policy; v[] is
+   estimated up front from `samples` random hands per depth, deepest first.
+   At MAX_MULLIGANS the hand is always kept.
+
+   Rollouts shuffle the bottomed cards back in with the rest of the library
+   rather than keeping them at the bottom; a goldfish game draws too few
+   cards for that to matter. */
+
+struct MulliganPolicy
+{
+    const Decklist *dl;
+    int max_turns;
+    int target;
+    int rollouts;
+    uint64_t seed;                             // keys rollout shuffles
+    double continue_value[MAX_MULLIGANS + 1];  // v[m]: expected value when drawing after m mulligans
+    pthread_mutex_t lock;                      // guards the cache below
+    uint64_t *keys;                            // open addressing, 0 = empty
+    float *values;
+    size_t cap;
+    size_t used;
+    long lookups;
+    long misses;
+};
+
+/* Build the policy for `dl`: resolves v[] by sampling `samples` hands per
+   depth. Returns 0 on success, -1 if out of memory. */
+int mulligan_policy_init(MulliganPolicy *p, const Decklist *dl, int max_turns, int target, int rollouts,
+                         int samples, uint64_t seed);
+void mulligan_policy_free(MulliganPolicy *p);
+
+/* Draw an opening hand into `gs` (a freshly shuffled game) under the London
+   mulligan: draw 7, mulligan by shuffling the hand back in with a new key
+   derived from `key`, and bottom one card per mulligan once a hand is
+   kept. Returns the number of mulligans taken. Safe to call from several
+   threads sharing `p`. */
+int london_mulligan(GameState *gs, MulliganPolicy *p, uint64_t key);
+
+/* Print v[] and the cache's size and hit rate */
+void print_mulligan_policy(const MulliganPolicy *p);
+
+#endif /* STORM_DECK_MULLIGAN_H */
@@ -0,0 +1,213 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "vars.h"
+#include "cards.h"
+#include "sim.h"
+#include "optimize.h"
+
+#define MAX_COPIES 4
+
+/* proposal RNG, separate from the games' shuffle seeds */
+static uint64_t rng_state;
+
+static uint64_t next_rand(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static int rand_below(int n)
+{
+    return (int)(next_rand() % (uint64_t)n);
+}
+
+static double rand_unit(void)
+{
+    return (double)(next_rand() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int is_basic_land(CardId id)
+{
+    return library[id].type == LAND && (library[id].supertype & SUPERTYPE_BASIC);
+}
+
+static void count_main(const Decklist *dl, int counts[MAX_LIBRARY], int *lands)
+{
+    memset(counts, 0, sizeof(int) * MAX_LIBRARY);
+    *lands = 0;
+    for (int i = 0; i < dl->main_count; ++i)
+    {
+        if (dl->main[i] == NO_CARD)
+            continue;
+        counts[dl->main[i]]++;
+        *lands += library[dl->main[i]].type == LAND;
+    }
+}
+
+/* Pick a legal swap: returns the main deck slot to change and sets *add to
+   the card to put there, or returns -1 if none was found. */
+static int propose_swap(const Decklist *dl, const CardId *pool, int npool, const OptimizeConfig *cfg, CardId *add)
+{
+    int counts[MAX_LIBRARY], lands;
+    count_main(dl, counts, &lands);
+    // the sideboard is fixed, but its copies count toward the 4-copy limit
+    for (int i = 0; i < dl->side_count; ++i)
+    {
+        if (dl->side[i] != NO_CARD)
+            counts[dl->side[i]]++;
+    }
+    for (int attempt = 0; attempt < 1000; ++attempt)
+    {
+        int slot = rand_below(dl->main_count);
+        CardId out = dl->main[slot];
+        CardId in = pool[rand_below(npool)];
+        if (out == NO_CARD || in == out)
+            continue;
+        if (counts[in] >= MAX_COPIES && !is_basic_land(in))
+            continue;
+        int new_lands = lands - (library[out].type == LAND) + (library[in].type == LAND);
+        if (new_lands < cfg->min_lands || new_lands > cfg->max_lands)
+            continue;
+        *add = in;
+        return slot;
+    }
+    return -1;
+}
+
+static void print_deck(const Decklist *dl)
+{
+    int counts[MAX_LIBRARY], lands;
+    count_main(dl, counts, &lands);
+    for (int id = 0; id < library_count; ++id)
+    {
+        if (counts[id])
+            printf("%d %s\n", counts[id], library[id].name);
+    }
+    if (dl->side_count > 0)
+    {
+        int side[MAX_LIBRARY] = {0};
+        for (int i = 0; i < dl->side_count; ++i)
+        {
+            if (dl->side[i] != NO_CARD)
+                side[dl->side[i]]++;
+        }
+        printf("\nSIDEBOARD:\n");
+        for (int id = 0; id < library_count; ++id)
+        {
+            if (side[id])
+                printf("%d %s\n", side[id], library[id].name);
+        }
+    }
+}
+
+/* Score `dl` on a fresh batch of games */
+static double evaluate(const Decklist *dl, const OptimizeConfig *cfg, unsigned seed)
+{
+    SimTrace t;
+    if (sim_trace_init(&t, cfg->games, cfg->max_turns, seed) != 0)
+        return 0.0;
+    run_traced(dl, &t);
+    double score = sim_trace_score(&t, cfg->target);
+    sim_trace_free(&t);
+    return score;
+}
+
+int optimize_deck(Decklist *dl, const OptimizeConfig *cfg)
+{
+    // candidate additions: every distinct card in the main deck or sideboard
+    CardId pool[MAX_LIBRARY];
+    int npool = 0;
+    int in_pool[MAX_LIBRARY] = {0};
+    for (int i = 0; i < dl->main_count + dl->side_count; ++i)
+    {
+        CardId id = i < dl->main_count ? dl->main[i] : dl->side[i - dl->main_count];
+        if (id != NO_CARD && !in_pool[id])
+        {
+            in_pool[id] = 1;
+            pool[npool++] = id;
+        }
+    }
+    if (npool < 2)
+    {
+        fprintf(stderr, "optimize: need at least two distinct cards\n");
+        return -1;
+    }
+
+    SimTrace cur, cand;
+    if (sim_trace_init(&cur, cfg->games, cfg->max_turns, cfg->seed) != 0 ||
+        sim_trace_init(&cand, cfg->games, cfg->max_turns, cfg->seed) != 0)
+    {
+        sim_trace_free(&cur);
+        fprintf(stderr, "optimize: out of memory\n");
+        return -1;
+    }
+    rng_state = ((uint64_t)cfg->seed << 1) ^ 0x2545F4914F6CDD1DULL;
+
+    const Decklist start = *dl;
+    run_traced(dl, &cur);
+    double cur_score = sim_trace_score(&cur, cfg->target);
+    const double start_score = cur_score;
+    double best_score = cur_score;
+    Decklist best = *dl;
+    long replayed = 0;
+    printf("Start: %.5f\n", cur_score);
+
+    for (int step = 0; step < cfg->steps; ++step)
+    {
+        CardId add;
+        int slot = propose_swap(dl, pool, npool, cfg, &add);
+        if (slot < 0)
+            break;
+        CardId removed = dl->main[slot];
+        dl->main[slot] = add;
+        sim_trace_copy(&cand, &cur);
+        replayed += rerun_traced_slot(dl, slot, &cand);
+        double score = sim_trace_score(&cand, cfg->target);
+
+        // linear cooling; at temperature 0 only improvements (and ties) pass
+        double temp = cfg->temperature * (1.0 - (double)step / (double)cfg->steps);
+        double delta = score - cur_score;
+        if (delta >= 0.0 || (temp > 0.0 && rand_unit() < exp(delta / temp)))
+        {
+            SimTrace tmp = cur;
+            cur = cand;
+            cand = tmp;
+            cur_score = score;
+            if (score > best_score)
+            {
+                best_score = score;
+                best = *dl;
+                printf("Step %d: -1 %s +1 %s -> %.5f\n", step, library[removed].name, library[add].name, score);
+            }
+        }
+        else
+            dl->main[slot] = removed;
+    }
+
+    *dl = best;
+    printf("Best: %.5f (start %.5f), replayed %ld of %ld games\n", best_score, start_score, replayed,
+           (long)cfg->steps * cfg->games);
+
+    // the search tuned itself to one set of shuffles; check on new ones
+    unsigned fresh = cfg->seed + 1;
+    printf("On fresh games: start %.5f, best %.5f\n", evaluate(&start, cfg, fresh), evaluate(&best, cfg, fresh));
+
+    int before[MAX_LIBRARY], after[MAX_LIBRARY], lands;
+    count_main(&start, before, &lands);
+    count_main(&best, after, &lands);
+    printf("Changes:\n");
+    for (int id = 0; id < library_count; ++id)
+    {
+        if (after[id] != before[id])
+            printf("  %+d %s\n", after[id] - before[id], library[id].name);
+    }
+    printf("\n");
+    print_deck(&best);
+
+    sim_trace_free(&cur);
+    sim_trace_free(&cand);
+    return 0;
+}
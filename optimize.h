@@ -0,0 +1,30 @@
+#ifndef STORM_DECK_OPTIMIZE_H
+#define STORM_DECK_OPTIMIZE_H
+
+#include "vars.h"
+
+/* Settings for the decklist optimizer */
+typedef struct
+{
+    long games;         // games per evaluation
+    int max_turns;      // target is measured by this turn
+    int target;         // SIM_TARGET_WIN or SIM_TARGET_DAMAGE (sim.h)
+    unsigned seed;      // common random numbers: the same for every deck
+    int steps;          // candidate swaps to try
+    double temperature; // initial annealing temperature; 0 = hill climbing
+    int min_lands;      // main deck land count must stay in this band
+    int max_lands;
+} OptimizeConfig;
+
+/* Search over the main deck's card counts by simulated annealing over
+   one-card swaps (-1 of a main deck card, +1 of any card in the main deck or
+   sideboard), keeping the main deck at its size, at most 4 copies of each
+   non-basic card across main deck and sideboard, and the land count in the
+   configured band. The sideboard itself is fixed: it is neither searched
+   nor changed, so a card can only gain main deck copies while main plus
+   side stays within 4. Every candidate is played on the same shuffles, and only
+   the games that reached the swapped slot are replayed. `dl` is replaced by
+   the best deck found. Prints progress and a summary; returns 0 on success. */
+int optimize_deck(Decklist *dl, const OptimizeConfig *cfg);
+
+#endif /* STORM_DECK_OPTIMIZE_H */
@@ -0,0 +1,51 @@
+#include "rng.h"
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+/* Philox4x32 with 10 rounds: encrypts ctr[] in place under `key` */
+static void philox4x32(uint32_t ctr[4], uint64_t key)
+{
+    uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+    for (int round = 0; round < 10; ++round)
+    {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * ctr[0];
+        uint64_t p1 = (uint64_t)PHILOX_M1 * ctr[2];
+        uint32_t c0 = (uint32_t)(p1 >> 32) ^ ctr[1] ^ k0;
+        uint32_t c2 = (uint32_t)(p0 >> 32) ^ ctr[3] ^ k1;
+        ctr[0] = c0;
+        ctr[1] = (uint32_t)p1;
+        ctr[2] = c2;
+        ctr[3] = (uint32_t)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+uint64_t rng_stream_key(uint64_t seed, uint64_t stream)
+{
+    uint32_t ctr[4] = {(uint32_t)stream, (uint32_t)(stream >> 32), 0, 0x6B657973u};
+    philox4x32(ctr, seed);
+    return ((uint64_t)ctr[1] << 32 | ctr[0]) | 1;
+}
+
+uint32_t rng_below(uint64_t key, uint32_t counter, uint32_t n)
+{
+    /* Lemire's multiply-and-reject: a 32-bit word w maps to (w * n) >> 32,
+       rejecting the few low products that would make some results more
+       likely. One block gives four words; more are almost never needed. */
+    uint32_t threshold = (uint32_t)-n % n;
+    for (uint32_t block = 0;; ++block)
+    {
+        uint32_t ctr[4] = {counter, block, 0, 0};
+        philox4x32(ctr, key);
+        for (int i = 0; i < 4; ++i)
+        {
+            uint64_t m = (uint64_t)ctr[i] * n;
+            if ((uint32_t)m >= threshold)
+                return (uint32_t)(m >> 32);
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef STORM_DECK_RNG_H
+#define STORM_DECK_RNG_H
+
+#include <stdint.h>
+
+/* Counter-based random numbers (Philox4x32-10).
+
+   A random value is a pure function of a 64-bit key and a counter, so there
+   is no generator state to share or advance: game g of a run with seed s
+   uses the key rng_stream_key(s, g), and the card drawn into library
+   position p uses counter p. A game therefore shuffles the same way no
+   matter which thread plays it or in which order. */
+
+/* Key for stream `stream` (e.g. a game index) of a run seeded with `seed`.
+   Never 0, so 0 can mean "no key". */
+uint64_t rng_stream_key(uint64_t seed, uint64_t stream);
+
+/* Uniform integer in [0, n) for position `counter` of stream `key`,
+   without modulo bias. n must be at least 1. */
+uint32_t rng_below(uint64_t key, uint32_t counter, uint32_t n);
+
+#endif /* STORM_DECK_RNG_H */
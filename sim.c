@@ -0,0 +1,504 @@
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "vars.h"
+#include "cards.h"
+#include "game.h"
+#include "sim.h"
+#include "rng.h"
+#include "mulligan.h"
+#include "metrics.h"
+
+/* Finisher held back until it is lethal or nothing else can be cast;
+   resolved once per run by sim_init. */
+static CardId grapeshot_id = NO_CARD;
+
+void sim_init(void)
+{
+    grapeshot_id = find_card("Grapeshot");
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int total_cost(CardId id)
+{
+    const Card *c = &library[id];
+    return c->cost_generic + c->cost_color[0] + c->cost_color[1] + c->cost_color[2];
+}
+
+/* Play the first land found in hand, else one from the impulse exile. */
+static void play_land_drop(GameState *gs)
+{
+    for (int i = 0; i < gs->hand_count; ++i)
+    {
+        if (library[handCards(gs)[i]].type == LAND)
+        {
+            playLand(gs, i);
+            return;
+        }
+    }
+    for (int i = 0; i < gs->impulse_count; ++i)
+    {
+        if (library[impulseCards(gs)[i]].type == LAND)
+        {
+            if (addToBattlefield(gs, removeFromExile(gs, i)) == 0)
+                gs->land_played = 1;
+            return;
+        }
+    }
+}
+
+/* Greedy goldfish policy: cast the cheapest castable spell from hand or
+   exile, holding Grapeshot until it is lethal or is the last play left. */
+static void play_main_phase(GameState *gs)
+{
+    play_land_drop(gs);
+    tapAllLands(gs);
+
+    for (;;)
+    {
+        int best = -1, best_cost = 0, best_exiled = 0;
+        int shot = -1, shot_exiled = 0;
+        for (int z = 0; z < 2; ++z)
+        {
+            const CardId *zone = z ? impulseCards(gs) : handCards(gs);
+            int n = z ? gs->impulse_count : gs->hand_count;
+            for (int i = 0; i < n; ++i)
+            {
+                CardId id = zone[i];
+                if (library[id].type == LAND || !canCast(gs, id))
+                    continue;
+                if (id == grapeshot_id)
+                {
+                    shot = i;
+                    shot_exiled = z;
+                    continue;
+                }
+                int cost = total_cost(id);
+                if (best < 0 || cost < best_cost)
+                {
+                    best = i;
+                    best_cost = cost;
+                    best_exiled = z;
+                }
+            }
+        }
+
+        if (shot >= 0 && (best < 0 || 1 + gs->storm_count >= gs->opponent_life))
+        {
+            best = shot;
+            best_exiled = shot_exiled;
+        }
+        if (best < 0)
+            return;
+
+        CardId id = best_exiled ? removeFromExile(gs, best) : removeFromHand(gs, best);
+        if (castCard(gs, id) < 0)
+            return;
+        if (gs->opponent_life <= 0)
+            return;
+    }
+}
+
+/* Cleanup step: discard down to HAND_SIZE. Extra lands go first (one is
+   kept for the next land drop), then the most expensive spells, and
+   Grapeshot last; ties discard the card drawn last. */
+static void discard_to_hand_size(GameState *gs)
+{
+    while (gs->hand_count > HAND_SIZE)
+    {
+        const CardId *hand = handCards(gs);
+        int lands = 0;
+        for (int i = 0; i < gs->hand_count; ++i)
+            lands += library[hand[i]].type == LAND;
+        int pick = 0, pick_rank = 0;
+        for (int i = 0; i < gs->hand_count; ++i)
+        {
+            int rank;
+            if (library[hand[i]].type == LAND)
+                rank = lands > 1 ? INT_MAX : -1;
+            else if (hand[i] == grapeshot_id)
+                rank = 0;
+            else
+                rank = 1 + total_cost(hand[i]);
+            if (i == 0 || rank >= pick_rank)
+            {
+                pick = i;
+                pick_rank = rank;
+            }
+        }
+        addToGraveyard(gs, removeFromHand(gs, pick));
+    }
+}
+
+int play_from_hand(GameState *gs, int max_turns)
+{
+    while (gs->turn < max_turns)
+    {
+        beginTurn(gs);
+        play_main_phase(gs);
+        if (gs->opponent_life <= 0)
+            return gs->turn;
+        discard_to_hand_size(gs);
+    }
+    return 0;
+}
+
+/* Draw the opening hand and play turns until a kill or max_turns */
+static int play_game(GameState *gs, int max_turns)
+{
+    for (int i = 0; i < HAND_SIZE; ++i)
+        drawCardToHand(gs);
+    return play_from_hand(gs, max_turns);
+}
+
+int play_goldfish(const Decklist *dl, int max_turns, uint64_t key, MulliganPolicy *mull, int *mulligans)
+{
+    GameState gs;
+    init_game(&gs, dl);
+    shuffle_library(&gs, key);
+    if (!mull)
+        return play_game(&gs, max_turns);
+    *mulligans = london_mulligan(&gs, mull, key);
+    return play_from_hand(&gs, max_turns);
+}
+
+/* A contiguous range of game indices played by one thread */
+typedef struct
+{
+    const Decklist *dl;
+    MulliganPolicy *mull;
+    uint64_t seed;
+    long first;
+    long count;
+    SimMetrics *metrics;
+    SimResult result;
+} SimChunk;
+
+static void *play_chunk(void *arg)
+{
+    SimChunk *c = arg;
+    SimResult *r = &c->result;
+    for (long g = c->first; g < c->first + c->count; ++g)
+    {
+        int mulligans = 0;
+        int kill = play_goldfish(c->dl, r->max_turns, rng_stream_key(c->seed, (uint64_t)g), c->mull, &mulligans);
+        metric_add(&c->metrics->games, 1);
+        metric_add(&c->metrics->wins, kill > 0);
+        metric_add(&c->metrics->turns, (uint64_t)(kill > 0 ? kill : r->max_turns));
+        if (kill > 0)
+        {
+            r->wins++;
+            r->wins_by_turn[kill]++;
+            r->kill_turn_sum += kill;
+        }
+        if (c->mull)
+        {
+            r->games_by_mulligans[mulligans]++;
+            if (kill > 0)
+                r->wins_by_mulligans[mulligans][kill]++;
+        }
+    }
+    return NULL;
+}
+
+/* Play games out->games .. out->games + games - 1 of `dl` into `out`, split
+   into one contiguous range per thread. Each game is keyed by its index
+   alone, so the totals do not depend on `threads`. */
+static void play_batch(const Decklist *dl, MulliganPolicy *mull, long games, uint64_t seed, int threads,
+                       SimResult *out)
+{
+    sim_init();
+    if (threads < 1)
+        threads = 1;
+    if (threads > MAX_SIM_THREADS)
+        threads = MAX_SIM_THREADS;
+    SimChunk chunks[MAX_SIM_THREADS];
+    pthread_t tids[MAX_SIM_THREADS];
+    double start = now_seconds();
+    long first = out->games;
+    for (int i = 0; i < threads; ++i)
+    {
+        long count = games / threads + (i < games % threads);
+        chunks[i] = (SimChunk){dl, mull, seed, first, count, &thread_metrics[i], {.max_turns = out->max_turns}};
+        first += count;
+        // the calling thread plays the last range itself
+        if (i + 1 < threads && pthread_create(&tids[i], NULL, play_chunk, &chunks[i]) != 0)
+        {
+            fprintf(stderr, "failed to start simulation thread; playing its games inline\n");
+            threads = i + 1;
+            break;
+        }
+    }
+    play_chunk(&chunks[threads - 1]);
+    for (int i = 0; i < threads; ++i)
+    {
+        if (i + 1 < threads)
+            pthread_join(tids[i], NULL);
+        const SimResult *r = &chunks[i].result;
+        out->wins += r->wins;
+        out->kill_turn_sum += r->kill_turn_sum;
+        for (int t = 0; t <= MAX_SIM_TURNS; ++t)
+            out->wins_by_turn[t] += r->wins_by_turn[t];
+        for (int m = 0; m <= MAX_MULLIGANS; ++m)
+        {
+            out->games_by_mulligans[m] += r->games_by_mulligans[m];
+            for (int t = 0; t <= MAX_SIM_TURNS; ++t)
+                out->wins_by_mulligans[m][t] += r->wins_by_mulligans[m][t];
+        }
+    }
+    out->games += games;
+    out->seconds += now_seconds() - start;
+}
+
+static void init_result(SimResult *out, int max_turns)
+{
+    memset(out, 0, sizeof(*out));
+    out->max_turns = max_turns > MAX_SIM_TURNS ? MAX_SIM_TURNS : max_turns;
+}
+
+void run_simulation(const Decklist *dl, MulliganPolicy *mull, long games, int max_turns, uint64_t seed, int threads,
+                    SimResult *out)
+{
+    init_result(out, max_turns);
+    play_batch(dl, mull, games, seed, threads, out);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Sequential stopping */
+
+/* Two-sided standard normal quantile for `confidence`, by bisection on erfc */
+static double normal_quantile(double confidence)
+{
+    double lo = 0.0, hi = 10.0;
+    for (int i = 0; i < 100; ++i)
+    {
+        double mid = 0.5 * (lo + hi);
+        if (erfc(mid / sqrt(2.0)) > 1.0 - confidence)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+void wilson_interval(long wins, long games, double confidence, double *lo, double *hi)
+{
+    if (games <= 0)
+    {
+        *lo = 0.0;
+        *hi = 1.0;
+        return;
+    }
+    double z = normal_quantile(confidence);
+    double n = (double)games;
+    double p = (double)wins / n;
+    double denom = 1.0 + z * z / n;
+    double centre = (p + z * z / (2.0 * n)) / denom;
+    double spread = z * sqrt(p * (1.0 - p) / n + z * z / (4.0 * n * n)) / denom;
+    *lo = centre - spread > 0.0 ? centre - spread : 0.0;
+    *hi = centre + spread < 1.0 ? centre + spread : 1.0;
+}
+
+static double rate(const SimResult *r)
+{
+    return r->games ? (double)r->wins / (double)r->games : 0.0;
+}
+
+int run_sequential(const Decklist *dl, const Decklist *other, int max_turns, uint64_t seed, int threads,
+                   const SimStop *stop, SimResult *out, SimResult *out_other)
+{
+    init_result(out, max_turns);
+    if (other)
+        init_result(out_other, max_turns);
+
+    double start = now_seconds();
+    while (out->games < stop->max_games)
+    {
+        long n = stop->batch;
+        if (n > stop->max_games - out->games)
+            n = stop->max_games - out->games;
+        play_batch(dl, NULL, n, seed, threads, out);
+        if (other)
+            play_batch(other, NULL, n, seed, threads, out_other);
+        double elapsed = now_seconds() - start;
+        long total = out->games + (other ? out_other->games : 0);
+        double speed = elapsed > 0.0 ? (double)total / elapsed : 0.0;
+
+        double lo, hi;
+        wilson_interval(out->wins, out->games, stop->confidence, &lo, &hi);
+        if (!other)
+        {
+            printf("%10ld games: %.5f [%.5f, %.5f]  %.0f games/s\n", out->games, rate(out), lo, hi, speed);
+            if (0.5 * (hi - lo) <= stop->half_width)
+                return 1;
+            continue;
+        }
+
+        /* Newcombe's interval for the difference of two independent
+           proportions, built from the two Wilson intervals */
+        double lo2, hi2;
+        wilson_interval(out_other->wins, out_other->games, stop->confidence, &lo2, &hi2);
+        double p1 = rate(out), p2 = rate(out_other);
+        double d = p1 - p2;
+        double d_lo = d - sqrt((p1 - lo) * (p1 - lo) + (hi2 - p2) * (hi2 - p2));
+        double d_hi = d + sqrt((hi - p1) * (hi - p1) + (p2 - lo2) * (p2 - lo2));
+        printf("%10ld games each: %.5f vs %.5f, difference %+.5f [%+.5f, %+.5f]  %.0f games/s\n",
+               out->games, p1, p2, d, d_lo, d_hi, speed);
+        if (d_lo > 0.0 || d_hi < 0.0)
+        {
+            printf("Decks differ at %.1f%% confidence: %s deck is better\n", 100.0 * stop->confidence,
+                   d > 0.0 ? "first" : "second");
+            return 1;
+        }
+        if (0.5 * (d_hi - d_lo) <= stop->half_width)
+        {
+            printf("No difference larger than %.5f at %.1f%% confidence\n", stop->half_width,
+                   100.0 * stop->confidence);
+            return 1;
+        }
+    }
+    printf("Stopped at %ld games per deck without reaching the target\n", out->games);
+    return 0;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Common random numbers */
+
+/* Play game g of `t` with `dl` and record which decklist slots it reached.
+   The lazy shuffle's steps only depend on how many cards were still
+   unshuffled, so replaying the steps the game took on slot numbers tells
+   which slot each card it looked at came from. */
+static void play_traced(const Decklist *dl, SimTrace *t, long g)
+{
+    GameState gs;
+    uint64_t key = rng_stream_key(t->seed, (uint64_t)g);
+    init_game(&gs, dl);
+    shuffle_library(&gs, key);
+    int kill = play_game(&gs, t->max_turns);
+    // traced games are played on the calling thread only
+    metric_add(&thread_metrics[0].games, 1);
+    metric_add(&thread_metrics[0].wins, kill > 0);
+    metric_add(&thread_metrics[0].turns, (uint64_t)(kill > 0 ? kill : t->max_turns));
+
+    int n = dl->main_count;
+    CardId slot[DECK_SIZE];
+    for (int i = 0; i < n; ++i)
+        slot[i] = (CardId)i;
+    uint64_t seen = 0;
+    for (int p = 0; p < n - gs.library_hidden; ++p)
+    {
+        int j = p + (int)rng_below(key, (uint32_t)(n - p), (uint32_t)(n - p));
+        CardId tmp = slot[p];
+        slot[p] = slot[j];
+        slot[j] = tmp;
+        seen |= 1ULL << slot[p];
+    }
+    t->kill_turn[g] = (uint8_t)kill;
+    t->damage[g] = (uint8_t)(OPPONENT_LIFE - (gs.opponent_life > 0 ? gs.opponent_life : 0));
+    t->seen[g] = seen;
+}
+
+int sim_trace_init(SimTrace *t, long games, int max_turns, unsigned seed)
+{
+    memset(t, 0, sizeof(*t));
+    t->games = games;
+    t->max_turns = max_turns > MAX_SIM_TURNS ? MAX_SIM_TURNS : max_turns;
+    t->seed = seed;
+    t->kill_turn = malloc((size_t)games);
+    t->damage = malloc((size_t)games);
+    t->seen = malloc(sizeof(uint64_t) * (size_t)games);
+    if (!t->kill_turn || !t->damage || !t->seen)
+    {
+        sim_trace_free(t);
+        return -1;
+    }
+    return 0;
+}
+
+void sim_trace_free(SimTrace *t)
+{
+    free(t->kill_turn);
+    free(t->damage);
+    free(t->seen);
+    memset(t, 0, sizeof(*t));
+}
+
+void sim_trace_copy(SimTrace *dst, const SimTrace *src)
+{
+    memcpy(dst->kill_turn, src->kill_turn, (size_t)src->games);
+    memcpy(dst->damage, src->damage, (size_t)src->games);
+    memcpy(dst->seen, src->seen, sizeof(uint64_t) * (size_t)src->games);
+}
+
+void run_traced(const Decklist *dl, SimTrace *t)
+{
+    sim_init();
+    for (long g = 0; g < t->games; ++g)
+        play_traced(dl, t, g);
+}
+
+long rerun_traced_slot(const Decklist *dl, int slot, SimTrace *t)
+{
+    sim_init();
+    uint64_t bit = 1ULL << slot;
+    long replayed = 0;
+    for (long g = 0; g < t->games; ++g)
+    {
+        if (t->seen[g] & bit)
+        {
+            play_traced(dl, t, g);
+            ++replayed;
+        }
+    }
+    return replayed;
+}
+
+double sim_trace_score(const SimTrace *t, int target)
+{
+    long sum = 0;
+    for (long g = 0; g < t->games; ++g)
+        sum += target == SIM_TARGET_WIN ? (t->kill_turn[g] != 0) : t->damage[g];
+    return t->games ? (double)sum / (double)t->games : 0.0;
+}
+
+void print_sim_result(const SimResult *r)
+{
+    printf("Simulated %ld games (max %d turns)\n", r->games, r->max_turns);
+    long cumulative = 0;
+    for (int t = 1; t <= r->max_turns; ++t)
+    {
+        cumulative += r->wins_by_turn[t];
+        printf("  turn %2d: %10ld wins  (%6.2f%% by this turn)\n", t, r->wins_by_turn[t],
+               r->games ? 100.0 * (double)cumulative / (double)r->games : 0.0);
+    }
+    if (r->wins > 0)
+        printf("Mean kill turn: %.3f\n", (double)r->kill_turn_sum / (double)r->wins);
+    else
+        printf("Mean kill turn: n/a (no wins)\n");
+    for (int m = 0; m <= MAX_MULLIGANS; ++m)
+    {
+        long n = r->games_by_mulligans[m];
+        if (n == 0)
+            continue;
+        printf("Mulligan to %d: %ld games\n", HAND_SIZE - m, n);
+        long cumulative = 0;
+        for (int t = 1; t <= r->max_turns; ++t)
+        {
+            cumulative += r->wins_by_mulligans[m][t];
+            printf("  turn %2d: %10ld wins  (%6.2f%% by this turn)\n", t, r->wins_by_mulligans[m][t],
+                   100.0 * (double)cumulative / (double)n);
+        }
+    }
+    printf("Throughput: %.0f games/s (%.3f s)\n",
+           r->seconds > 0.0 ? (double)r->games / r->seconds : 0.0, r->seconds);
+}
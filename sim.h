@@ -0,0 +1,129 @@
+#ifndef STORM_DECK_SIM_H
+#define STORM_DECK_SIM_H
+
+#include "vars.h"
+
+/* Longest game the simulator will play out */
+#define MAX_SIM_TURNS 20
+
+/* Most threads a batch of games is split across */
+#define MAX_SIM_THREADS 64
+
+/* Deepest London mulligan the simulator takes (keeps 7 - MAX_MULLIGANS) */
+#define MAX_MULLIGANS 3
+
+/* Keep/mulligan policy, see mulligan.h */
+typedef struct MulliganPolicy MulliganPolicy;
+
+/* Aggregate results of a batch of goldfish games */
+typedef struct
+{
+    long games;
+    int max_turns;
+    long wins;                             // games that killed by max_turns
+    long wins_by_turn[MAX_SIM_TURNS + 1];  // index = kill turn
+    long kill_turn_sum;                    // sum of kill turns over wins
+    double seconds;                        // wall time for the batch
+    // split by mulligans taken; only filled when a policy is used
+    long games_by_mulligans[MAX_MULLIGANS + 1];
+    long wins_by_mulligans[MAX_MULLIGANS + 1][MAX_SIM_TURNS + 1];
+} SimResult;
+
+/* Resolve the card ids the goldfish policy looks for. Called by the run
+   functions below; call it before play_from_hand otherwise. */
+void sim_init(void);
+
+/* Play turns of `gs`, whose opening hand is already drawn, until a kill
+   or `max_turns`, discarding down to HAND_SIZE at the end of each turn.
+   Returns the kill turn, or 0. */
+int play_from_hand(GameState *gs, int max_turns);
+
+/* Play a single goldfish game of `dl`, shuffled with rng key `key` (see
+   rng.h). The opening hand is kept as drawn, or chosen by London mulligan
+   under `mull` if it is not NULL, in which case *mulligans is set to the
+   number taken. Returns the turn the opponent died on, or 0 if they
+   survived `max_turns`. */
+int play_goldfish(const Decklist *dl, int max_turns, uint64_t key, MulliganPolicy *mull, int *mulligans);
+
+/* Play `games` goldfish games of `dl` on `threads` threads and fill `out`,
+   mulliganing under `mull` if it is not NULL. Game g is shuffled with
+   rng_stream_key(seed, g), so the result depends on the seed but not on
+   the thread count. The card library and decklist are only read, so
+   callers build them once per run. */
+void run_simulation(const Decklist *dl, MulliganPolicy *mull, long games, int max_turns, uint64_t seed, int threads,
+                    SimResult *out);
+
+/* Print win-by-turn counts, split by mulligans when a policy was used,
+   mean kill turn and throughput */
+void print_sim_result(const SimResult *r);
+
+/* Sequential stopping rule for run_sequential. Games are played in batches
+   of `batch`; after each batch the Wilson score interval of the win rate is
+   checked. A single deck stops once the interval's half-width is at most
+   `half_width`; a comparison stops once the interval of the difference in
+   win rates excludes zero, or is itself narrower than +-half_width. Either way at most `max_games` are played per
+   deck. Every check is a fresh look at the same data, so with many batches
+   the real error rate is somewhat above 1 - confidence. */
+typedef struct
+{
+    double half_width;  // target half-width of the win-rate interval
+    double confidence;  // e.g. 0.95
+    long batch;         // games between checks
+    long max_games;     // per deck
+} SimStop;
+
+/* Two-sided Wilson score interval for `wins` out of `games` */
+void wilson_interval(long wins, long games, double confidence, double *lo, double *hi);
+
+/* Play `dl` (and, if `other` is not NULL, `other` alongside it, one batch
+   each, on the same shuffles) until `stop` is met. Shared shuffles make the
+   two win rates positively correlated, so the difference interval, which
+   assumes independent samples, is conservative. Prints the interval after every batch and fills
+   `out` (and `out_other`). Returns 1 if the stopping condition was met, 0 if
+   max_games ran out first. */
+int run_sequential(const Decklist *dl, const Decklist *other, int max_turns, uint64_t seed, int threads,
+                   const SimStop *stop, SimResult *out, SimResult *out_other);
+
+/* Per-game record of a batch played with common random numbers: game g is
+   always shuffled with the same rng key, derived from (seed, g), so decks that
+   differ in one decklist slot see the same permutation and can be compared
+   game by game. `seen` records which decklist slots each game drew or
+   exiled; a game that never saw a slot plays out identically when only that
+   slot changes. */
+typedef struct
+{
+    long games;
+    int max_turns;
+    unsigned seed;
+    uint8_t *kill_turn; // turn the opponent died, 0 if they survived
+    uint8_t *damage;    // damage dealt by the end of the game
+    uint64_t *seen;     // bit i set: decklist slot i was drawn or exiled
+} SimTrace;
+
+_Static_assert(DECK_SIZE <= 64, "SimTrace.seen holds one bit per deck slot");
+
+/* Scores a SimTrace can be reduced to */
+enum
+{
+    SIM_TARGET_WIN,   // fraction of games won by max_turns
+    SIM_TARGET_DAMAGE // mean damage dealt by max_turns
+};
+
+/* Allocate a trace for `games` games; returns 0 on success */
+int sim_trace_init(SimTrace *t, long games, int max_turns, unsigned seed);
+void sim_trace_free(SimTrace *t);
+
+/* Copy the per-game records of `src` (same size) into `dst` */
+void sim_trace_copy(SimTrace *dst, const SimTrace *src);
+
+/* Play every game of `t` with `dl` */
+void run_traced(const Decklist *dl, SimTrace *t);
+
+/* Update `t`, recorded for a deck that differed from `dl` only in decklist
+   slot `slot`, by replaying just the games that saw that slot. Returns the
+   number of games replayed. */
+long rerun_traced_slot(const Decklist *dl, int slot, SimTrace *t);
+
+double sim_trace_score(const SimTrace *t, int target);
+
+#endif /* STORM_DECK_SIM_H */
@@ -0,0 +1,81 @@
+/* Card conservation: no zone may lose or invent a card. Run from the
+   repository root (`make test`) so cards.db / cards.txt are found. */
+#include <stdio.h>
+#include "../vars.h"
+#include "../cards.h"
+#include "../game.h"
+#include "../sim.h"
+#include "../rng.h"
+
+#define TEST_TURNS 20
+#define TEST_GAMES 2000
+
+static int failures;
+
+static int zone_total(const GameState *gs)
+{
+    return gs->library_count + gs->hand_count + gs->battlefield_count + gs->graveyard_count +
+           gs->exile_count;
+}
+
+/* Play `dl` one turn at a time and check the zones after every turn. */
+static void check_game(const Decklist *dl, uint64_t key, const char *what)
+{
+    GameState gs;
+    init_game(&gs, dl);
+    shuffle_library(&gs, key);
+    for (int i = 0; i < HAND_SIZE; ++i)
+        drawCardToHand(&gs);
+    for (int t = 1; t <= TEST_TURNS; ++t)
+    {
+        int kill = play_from_hand(&gs, t);
+        if (zone_total(&gs) != dl->main_count || gs.hand_count > HAND_SIZE)
+        {
+            fprintf(stderr,
+                    "%s, key %llu, turn %d: library %d + hand %d + battlefield %d + graveyard %d + "
+                    "exile %d != %d\n",
+                    what, (unsigned long long)key, gs.turn, gs.library_count, gs.hand_count,
+                    gs.battlefield_count, gs.graveyard_count, gs.exile_count, dl->main_count);
+            failures++;
+            return;
+        }
+        if (kill)
+            return;
+    }
+}
+
+int main(void)
+{
+    if (init_cards() != 0)
+    {
+        fprintf(stderr, "zones_test: cannot load the card library\n");
+        return 1;
+    }
+    sim_init();
+
+    /* No-action hand: without lands nothing is ever cast, so every turn is
+       a draw and a discard. */
+    Decklist idle = {0};
+    idle.main_count = DECK_SIZE;
+    for (int i = 0; i < DECK_SIZE; ++i)
+        idle.main[i] = find_card("Grapeshot");
+    for (long g = 0; g < TEST_GAMES; ++g)
+        check_game(&idle, rng_stream_key(1, (uint64_t)g), "no-action deck");
+
+    /* One of every card over and over, so effect draws, impulse exiles and
+       storm copies all happen. */
+    Decklist mixed = {0};
+    mixed.main_count = DECK_SIZE;
+    for (int i = 0; i < DECK_SIZE; ++i)
+        mixed.main[i] = (CardId)(i % library_count);
+    for (long g = 0; g < TEST_GAMES; ++g)
+        check_game(&mixed, rng_stream_key(2, (uint64_t)g), "mixed deck");
+
+    if (failures)
+    {
+        fprintf(stderr, "zones_test: %d game(s) lost or invented cards\n", failures);
+        return 1;
+    }
+    printf("zones_test: %d games x %d turns, every card accounted for\n", 2 * TEST_GAMES, TEST_TURNS);
+    return 0;
+}
@@ -4,6 +4,7 @@
 #ifndef STORM_DECK_VARS_H
 #define STORM_DECK_VARS_H
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -11,6 +12,9 @@
 #define DECK_SIZE 60
 #define HAND_SIZE 7
 #define SIDEBOARD_SIZE 15
+// Zones have no capacities of their own: the library, hand, battlefield,
+// graveyard and exile share the DECK_SIZE slots of GameState.cards, so no
+// zone overflows while the game holds at most DECK_SIZE cards.
 
 // Card types
 #define CREATURE 0
@@ -21,53 +25,108 @@
 #define LAND 5
 #define MDFC 6
 
+// Supertypes (bits of Card.supertype)
+#define SUPERTYPE_BASIC 1
+
 // Colors
 #define RED 0
 #define BLUE 1
 #define GREEN 2
 #define COLORLESS 3
 
+/* Mana pool slots. Mana is pooled by the set of colors it may still be
+   spent as, indexed by a bitmask over RED/BLUE/GREEN: a unit's color is only
+   chosen when it pays for something (see castCard), so "any color" mana and
+   dual-land mana never branch on a color choice. Slot 0 is colorless. */
+#define MANA_BIT(color) (1 << (color))
+#define MANA_COLORLESS 0
+#define MANA_ANY 7
+#define MANA_SLOTS 8
+
 // Initial Numbers
 #define STARTING_LIFE 20
 #define OPPONENT_LIFE 20
 
+/* Card ids index the cold `library[]` table (see cards.h). NO_CARD marks an
+   unknown decklist entry or an empty slot. */
+typedef uint8_t CardId;
+#define NO_CARD ((CardId)0xFF)
+
 /* forward declare GameState so function-pointer types in Card may refer to
    it before the full GameState definition below */
 typedef struct GameState GameState;
 
+/* Immutable card data ("cold" table). One entry per card name, shared by
+   every game; game states only ever refer to cards by CardId. */
 typedef struct
 {
     const char *name;
     int type;
+    int supertype; // SUPERTYPE_* bits
     int cost_generic;
     // red, blue, green
     int cost_color[3];
-    /* typed card-effect callback that receives a pointer to the game
-       state and an integer (for example, card instance id). Use this
-       for real effect implementations. */
-    void (*affect)(GameState *, int);
+    /* card-effect callback, called by castCard once the cost is paid with
+       the game state and the CardId of the card being cast. */
+    void (*affect)(GameState *, CardId);
     int power;
     int toughness;
-    void *effect;
+    /* lands: mana slot the land taps for (a MANA_BIT mask) */
+    int produces;
     void (*activated_abilities)(GameState *, int);
-    int tapped;
 } Card;
 
-/* Define GameState (uses Card defined above). We declared the typedef
-   earlier so code can use 'GameState' as an alias for 'struct GameState'. */
+/* Compact per-game state ("hot" data). The zones are consecutive runs of
+   one card array, so copying a state is a single small memcpy and millions
+   of them fit in memory at once. */
 struct GameState
 {
-    int player_life;
-    int opponent_life;
-    int player_mana[4]; // red, blue, green, colorless
-    int deck[DECK_SIZE];
-    int sideboard[SIDEBOARD_SIZE];
-    Card hand[HAND_SIZE];
-    int turn;
-    Card battlefield[DECK_SIZE];
-    Card graveyard[DECK_SIZE];
-    int storm_count;
-    Card exile[DECK_SIZE];
+    /* rng key the library is lazily shuffled with as cards are drawn (see
+       shuffle_library); 0 while the library is in a fixed order */
+    uint64_t shuffle_key;
+    uint64_t tapped; // bit i set -> battlefield card i is tapped
+    int8_t player_life;
+    int8_t opponent_life;
+    uint8_t turn;
+    uint8_t storm_count;
+    uint8_t player_mana[MANA_SLOTS]; // units per color mask, see MANA_BIT
+    uint8_t land_played;
+    /* The top library_known cards of the library are in a fixed order, the
+       next library_hidden are still to be shuffled in (see
+       shuffle_library), and any cards below those were put on the bottom
+       in order. */
+    uint8_t library_count;
+    uint8_t library_known;
+    uint8_t library_hidden;
+    uint8_t hand_count;
+    uint8_t battlefield_count;
+    uint8_t graveyard_count;
+    uint8_t exile_count;
+    /* the last impulse_count exiled cards were exiled this turn and may
+       still be played; older ones stay in exile for the rest of the game */
+    uint8_t impulse_count;
+    /* token copies on the battlefield; they have no card behind them, so
+       they are only counted */
+    uint16_t tokens;
+    /* Every card of the game, zone by zone: the library (bottom card
+       first, top card last), then the hand, battlefield, graveyard and
+       exile, each in the order the cards arrived. The zones share the
+       DECK_SIZE slots, so a card leaving one zone always has room in
+       another and no zone can overflow on its own. */
+    CardId cards[DECK_SIZE];
 };
 
+_Static_assert(DECK_SIZE <= 64, "tapped holds one bit per battlefield card");
+_Static_assert(sizeof(GameState) <= 128, "GameState should fit in two cache lines");
+
+/* Parsed decklist: card ids for the main deck and sideboard. Built once per
+   run and copied into each game's library. */
+typedef struct
+{
+    CardId main[DECK_SIZE];
+    int main_count;
+    CardId side[SIDEBOARD_SIZE];
+    int side_count;
+} Decklist;
+
 #endif /* STORM_DECK_VARS_H */